@@ -0,0 +1,1808 @@
+/*
+    Copyright (C) 2011-2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "analysercore.h"
+#include "spectralflux.h"
+#include "frameengine.h"
+#include "onsetenvelope.h"
+#include "onlinetempo.h"
+#include "onsetthreshold.h"
+#include "bandtempo.h"
+#include "beattracker.h"
+#include "octaveresolver.h"
+#include "samplering.h"
+#include "resultcache.h"
+#include "envelopefile.h"
+#include "loudnessmeter.h"
+#include "pcmfile.h"
+#include <gst/app/gstappsink.h>
+
+#include <QtCore>
+#if QT_VERSION >= 0x050000
+ #include <QtConcurrent/QtConcurrent>
+#else
+ #include <QtConcurrentRun>
+#endif
+
+#include <gst/audio/audio.h>
+#include <climits>
+#include <math.h>
+
+#define AUDIOFREQ 44100
+#define THRESHOLD_WINDOW_SIZE 10
+#define MULTIPLIER 2.0f
+#define SCAN_WINDOWS 3
+#define SCAN_DURATION 30
+#define RING_FRAMES 65536
+#define PCM_CHUNK_FRAMES 8192
+// parts of a chunked track: shortest part, decoded lead-in and tail
+#define CHUNK_MIN_SECONDS 60
+#define CHUNK_PREROLL_SECONDS 2
+#define CHUNK_TAIL_SECONDS 1
+#define CHUNK_THRESHOLD_SECONDS 600
+// bump when a change of the analysis changes its results
+#define RESULT_VERSION 4
+
+
+// runs the dsp of a pipelined analyser while the streaming thread decodes
+class AnalysisThread : public QThread
+{
+public:
+    AnalysisThread(AnalyserCore *analyser) : m_analyser(analyser) {}
+protected:
+    void run() { m_analyser->consumeSamples(); }
+private:
+    AnalyserCore *m_analyser;
+};
+
+struct AnalyserCore_Private
+{
+        QFutureWatcher<void> watcher;
+        QMutex mutex;
+        float fft_res;
+        int analysisRate;
+        bool mono;
+        int rate;
+        int hop;
+        GstElement *capsfilter;
+        OnsetEnvelope envelope;
+        int bpm;
+        GstElement *conv, *sink, *cutter, *audio, *analysis, *audioConvert;
+        bool gainElements;
+        bool elementsLinked;
+        bool measureLoudness;
+        LoudnessMeter loudness;
+        bool pcmFastPath;
+        PcmFile pcm;
+        QFuture<void> sourceTask;
+        QVector<float> pcmBuffer;
+        qint64 sourceFrames;
+        const float *memory;
+        int memoryChannels;
+        FrameEngine::presetType preset;
+        int rawRate;
+        int rawChannels;
+        int rawType;
+        bool rawBigEndian;
+        int chunks;
+        int chunkSeconds;
+        QList<AnalyserCore*> chunkCores;
+        QVector<qint64> chunkFrames;
+        int chunksUsed;
+        bool chunking;
+        qint64 rangeFirst;
+        qint64 rangeLast;
+        qint64 firstSample;
+        int dropFrames;
+        AnalyserCore::modeType analysisMode;
+        float *xcorr;
+        GstCaps *sinkCaps;
+        int channels;
+        float *carry;
+        int carryFrames;
+        float *frame;
+        float *mono;
+        int frameSize;
+        bool pipelined;
+        SampleRing ring;
+        QThread *analysisThread;
+        QAtomicInt quit;
+        ResultCache *cache;
+        QString file;
+        bool cached;
+        bool failed;
+        QString envelopeFile;
+        int envelopeFlags;
+        BandTempo bandTempo[SpectralFlux::BAND_COUNT];
+        float bandWeights[SpectralFlux::BAND_COUNT];
+        BeatTracker beatTracker;
+        OctaveResolver octave;
+        bool octaveCorrection;
+        float octaveConfidence;
+        bool instrumented;
+        AnalysisStats stats;
+        qint64 startedAt;
+        FrameEngine *engine;
+        OnlineTempo online;
+        bool onlineMode;
+        int onlineInterval;
+        int onlineIntervalMs;
+        bool medianThreshold;
+        int earlyStopSecs;
+        float earlyStopConfidence;
+        int stableFrames;
+        float confidence;
+        QAtomicInt finishing;
+        QAtomicInt stopping;
+        int track;
+        int scanWindows;
+        int scanDuration;
+        QList<QTime> scanStarts;
+        int scanIndex;
+        QAtomicInt scanBoundary;
+        int skipFrames;
+};
+
+AnalyserCore::AnalyserCore(QObject *parent) :
+        QObject(parent),
+    pipeline(0), m_finished(false)
+    , p( new AnalyserCore_Private )
+{
+    p->analysisMode = AnalyserCore::STANDARD;
+    p->xcorr = 0;
+    p->bpm = 0;
+    p->onlineMode = false;
+    p->onlineInterval = 1;
+    p->onlineIntervalMs = 1000;
+    p->medianThreshold = false;
+    p->earlyStopSecs = 0;
+    p->earlyStopConfidence = 0;
+    p->confidence = 0;
+    p->track = 0;
+    p->scanWindows = SCAN_WINDOWS;
+    p->scanDuration = SCAN_DURATION;
+    p->pipelined = false;
+    p->analysisThread = 0;
+    p->cache = 0;
+    p->cached = false;
+    p->failed = false;
+    p->envelopeFlags = 0;
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        p->bandWeights[b] = b == SpectralFlux::ALL ? 1 : 0;
+    p->octaveCorrection = true;
+    p->octaveConfidence = 0;
+    p->instrumented = false;
+    p->startedAt = 0;
+    p->gainElements = false;
+    p->elementsLinked = false;
+    p->measureLoudness = false;
+    p->pcmFastPath = true;
+    p->sourceFrames = 0;
+    p->memory = 0;
+    p->memoryChannels = 0;
+    p->preset = FrameEngine::FAST;
+    p->rawRate = 44100;
+    p->rawChannels = 2;
+    p->rawType = PcmFile::S16;
+    p->rawBigEndian = false;
+    p->chunks = 0;
+    p->chunkSeconds = CHUNK_THRESHOLD_SECONDS;
+    p->chunksUsed = 0;
+    p->chunking = false;
+    p->rangeFirst = -1;
+    p->rangeLast = -1;
+    p->firstSample = -1;
+    p->dropFrames = 0;
+
+    p->analysisRate = AUDIOFREQ;
+    p->mono = false;
+    p->rate = 0;
+
+    //setenv("GST_DEBUG", "*:3", 1); //unix
+
+    gst_init (0, 0);
+    prepare();
+    configureRate(AUDIOFREQ);
+    connect(&p->watcher, SIGNAL(finished()), this, SLOT(loadThreadFinished()));
+
+}
+
+void AnalyserCore::sync_set_state(GstElement* element, GstState state)
+{ GstStateChangeReturn res; \
+        res = gst_element_set_state (GST_ELEMENT (element), state); \
+        if(res == GST_STATE_CHANGE_FAILURE) return; \
+        if(res == GST_STATE_CHANGE_ASYNC) { \
+                GstState state; \
+                        res = gst_element_get_state(GST_ELEMENT (element), &state, NULL, 1000000000/*GST_CLOCK_TIME_NONE*/); \
+                        if(res == GST_STATE_CHANGE_FAILURE || res == GST_STATE_CHANGE_ASYNC) return; \
+} }
+
+AnalyserCore::~AnalyserCore()
+{
+    stopSource();
+    stopChunks();
+    qDeleteAll(p->chunkCores);
+    cleanup();
+    setPipelined(false);
+    delete p->engine;
+    gst_caps_replace (&p->sinkCaps, NULL);
+    g_free (p->carry);
+    g_free (p->frame);
+    g_free (p->mono);
+    if ( p->analysis ) gst_object_unref (p->analysis);
+    if ( p->cutter ) gst_object_unref (p->cutter);
+    delete p;
+    p=0;
+}
+
+
+void cb_newpad_ta (GstElement *decodebin,
+                   GstPad     *pad,
+                   gpointer    data)
+{
+    AnalyserCore* instance = (AnalyserCore*)data;
+            instance->newpad(decodebin, pad, data);
+}
+
+
+void AnalyserCore::newpad (GstElement *decodebin,
+                   GstPad     *pad,
+                   gpointer    data)
+{
+        GstCaps *caps;
+        GstStructure *str;
+        GstPad *audiopad;
+
+        /* only link once */
+        GstElement *audio = gst_bin_get_by_name(GST_BIN(pipeline), "audiobin");
+        audiopad = gst_element_get_static_pad (audio, "sink");
+        gst_object_unref(audio);
+
+        if (GST_PAD_IS_LINKED (audiopad)) {
+                g_object_unref (audiopad);
+                return;
+        }
+
+        /* check media type */
+#ifdef GST_API_VERSION_1
+        caps = gst_pad_query_caps (pad,NULL);
+#else
+        caps = gst_pad_get_caps (pad);
+#endif
+        str = gst_caps_get_structure (caps, 0);
+        if (!g_strrstr (gst_structure_get_name (str), "audio")) {
+                gst_caps_unref (caps);
+                gst_object_unref (audiopad);
+                return;
+        }
+        gst_caps_unref (caps);
+
+        /* link'n'play */
+        gst_pad_link (pad, audiopad);
+}
+
+GstBusSyncReply AnalyserCore::bus_cb (GstBus *bus, GstMessage *msg, gpointer data)
+{
+    AnalyserCore* instance = (AnalyserCore*)data;
+            instance->messageReceived(msg);
+    return GST_BUS_PASS;
+}
+
+GstFlowReturn AnalyserCore::cb_new_sample (GstAppSink *appsink, gpointer data)
+{
+    AnalyserCore* instance = (AnalyserCore*)data;
+    GstSample *sample = gst_app_sink_pull_sample (appsink);
+    if ( !sample )
+        return GST_FLOW_EOS;
+
+    instance->dataReceived(sample);
+    gst_sample_unref (sample);
+    return GST_FLOW_OK;
+}
+
+void AnalyserCore::cleanup()
+{
+        if(pipeline) sync_set_state (GST_ELEMENT (pipeline), GST_STATE_NULL);
+        if(bus) gst_object_unref (bus);
+        if(pipeline) gst_object_unref(G_OBJECT(pipeline));
+}
+
+bool AnalyserCore::prepare()
+{
+        GstElement *dec, *audio, *audioConvert, *resample;
+        GstPad *audiopad;
+
+        p->sinkCaps = NULL;
+        p->channels = 0;
+        p->carry = NULL;
+        p->carryFrames = 0;
+        p->frame = NULL;
+        p->mono = NULL;
+        p->frameSize = 0;
+        p->engine = FrameEngine::create(FrameEngine::FAST);
+
+        pipeline = gst_pipeline_new ("pipeline");
+        bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+#ifdef GST_API_VERSION_1
+        dec = gst_element_factory_make ("decodebin", "decoder");
+#else
+        dec = gst_element_factory_make ("decodebin2", "decoder");
+#endif
+        g_signal_connect (dec, "pad-added", G_CALLBACK (cb_newpad_ta), this);
+        gst_bin_add (GST_BIN (pipeline), dec);
+
+        audio = gst_bin_new ("audiobin");
+        p->audio = audio;
+        p->conv = gst_element_factory_make ("audioconvert", "conv");
+        audioConvert = gst_element_factory_make("audioconvert", "audio_converter");
+        p->audioConvert = audioConvert;
+        // optional, only in the bin while they measure gain and silence
+        p->analysis = gst_element_factory_make ("rganalysis", "analysis");
+        p->cutter = gst_element_factory_make ("cutter", "cutter");
+        resample = gst_element_factory_make ("audioresample", "resample");
+        p->capsfilter = gst_element_factory_make ("capsfilter", "analysis_format");
+        p->sink = gst_element_factory_make ("appsink", "sink");
+        audiopad = gst_element_get_static_pad (p->conv, "sink");
+
+        if ( p->analysis && p->cutter ) {
+            gst_object_ref_sink (p->analysis);
+            gst_object_ref_sink (p->cutter);
+            g_object_set (p->analysis, "message", TRUE, NULL);
+            g_object_set (p->analysis, "num-tracks", 1, NULL);
+            g_object_set (p->cutter, "threshold-dB", -25.0, NULL);
+        } else {
+            if ( p->analysis ) gst_object_unref (p->analysis);
+            if ( p->cutter ) gst_object_unref (p->cutter);
+            p->analysis = NULL;
+            p->cutter = NULL;
+        }
+
+
+        // samples are pulled in the streaming thread as fast as they are decoded
+        GstAppSinkCallbacks callbacks = { NULL, NULL, cb_new_sample, { NULL } };
+        gst_app_sink_set_callbacks (GST_APP_SINK (p->sink), &callbacks, this, NULL);
+        g_object_set (G_OBJECT (p->sink), "sync", FALSE, "emit-signals", FALSE, NULL);
+
+        gst_bin_add_many (GST_BIN (audio), p->conv, audioConvert, resample, p->capsfilter, p->sink, NULL);
+
+        // downmix and decimation happen before the sink
+        gst_element_link_many (p->conv, audioConvert, resample, p->capsfilter, p->sink, NULL);
+        updateSinkCaps();
+        gst_element_add_pad (audio, gst_ghost_pad_new ("sink", audiopad));
+
+        gst_bin_add (GST_BIN (pipeline), audio);
+
+        GstElement *l_src;
+        l_src = gst_element_factory_make ("filesrc", "localsrc");
+        gst_bin_add_many (GST_BIN (pipeline), l_src, NULL);
+        gst_element_set_state (l_src, GST_STATE_NULL);
+        gst_element_link ( l_src,dec);
+
+        gst_object_unref (audiopad);
+
+#ifdef GST_API_VERSION_1
+        gst_bus_set_sync_handler (bus, bus_cb, this, NULL);
+#else
+        gst_bus_set_sync_handler (bus, bus_cb, this);
+#endif
+
+        // warm up, every track starts from READY
+        sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+
+        return pipeline;
+}
+
+void AnalyserCore::linkAudioBin()
+{
+    // the elements see the source format, so they go between the two converters
+    bool link = p->gainElements && p->analysisMode != TEMPO && p->analysis;
+    if ( link == p->elementsLinked )
+        return;
+
+    if ( link ) {
+        gst_element_unlink (p->conv, p->audioConvert);
+        gst_bin_add_many (GST_BIN (p->audio), p->analysis, p->cutter, NULL);
+        gst_element_link_many (p->conv, p->analysis, p->cutter, p->audioConvert, NULL);
+        gst_element_sync_state_with_parent (p->analysis);
+        gst_element_sync_state_with_parent (p->cutter);
+    } else {
+        gst_element_unlink_many (p->conv, p->analysis, p->cutter, p->audioConvert, NULL);
+        gst_element_set_state (p->analysis, GST_STATE_NULL);
+        gst_element_set_state (p->cutter, GST_STATE_NULL);
+        // the bin drops its references, ours keep the elements for later
+        gst_bin_remove_many (GST_BIN (p->audio), p->analysis, p->cutter, NULL);
+        gst_element_link (p->conv, p->audioConvert);
+    }
+    p->elementsLinked = link;
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" gain elements"<<link;
+}
+
+void AnalyserCore::setGainElements(bool enabled)
+{
+    if ( enabled && !p->analysis )
+        qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" rganalysis or cutter missing, measuring in-house";
+    p->gainElements = enabled;
+}
+
+void AnalyserCore::updateSinkCaps()
+{
+    GstCaps *caps = gst_caps_new_simple ("audio/x-raw",
+                                         "format", G_TYPE_STRING, GST_AUDIO_NE(F32),
+                                         "layout", G_TYPE_STRING, "interleaved",
+                                         NULL);
+    if ( p->analysisRate > 0 )
+        gst_caps_set_simple (caps, "rate", G_TYPE_INT, p->analysisRate, NULL);
+    if ( p->mono )
+        gst_caps_set_simple (caps, "channels", G_TYPE_INT, 1, NULL);
+    else
+        gst_caps_set_simple (caps, "channels", G_TYPE_INT, 2, NULL);
+
+    g_object_set (G_OBJECT (p->capsfilter), "caps", caps, NULL);
+    gst_caps_unref (caps);
+}
+
+void AnalyserCore::setAnalysisRate(int rate, bool mono)
+{
+    QMutexLocker locker(&p->mutex);
+    p->analysisRate = qMax(0, rate);
+    p->mono = mono;
+    updateSinkCaps();
+    if ( p->analysisRate > 0 )
+        configureRate(p->analysisRate);
+}
+
+void AnalyserCore::setPreset(FrameEngine::presetType preset)
+{
+    QMutexLocker locker(&p->mutex);
+    delete p->engine;
+    p->preset = preset;
+    p->engine = FrameEngine::create(preset);
+    p->engine->setStats(p->instrumented ? &p->stats : 0);
+    configureRate(p->rate > 0 ? p->rate : AUDIOFREQ);
+}
+
+void AnalyserCore::configureRate(int rate)
+{
+    if ( rate <= 0 )
+        return;
+
+    // keep the frame rate of the onsets near the 44100 Hz one, whatever the sample rate
+    p->rate = rate;
+    p->engine->configure(rate);
+    p->hop = p->engine->hop();
+    p->fft_res = p->engine->frameRate(); //sample rate for fft samples in Hz
+    p->onlineInterval = qMax(1, qRound(p->onlineIntervalMs * p->fft_res / 1000));
+
+    if ( p->onlineMode )
+        p->online.setup(p->fft_res);
+}
+
+int AnalyserCore::negotiatedRate()
+{
+    gint rate = 0;
+    GstPad *pad = gst_element_get_static_pad (p->sink, "sink");
+    GstCaps *caps = gst_pad_get_current_caps (pad);
+    if ( caps ) {
+        gst_structure_get_int (gst_caps_get_structure (caps, 0), "rate", &rate);
+        gst_caps_unref (caps);
+    }
+    gst_object_unref (pad);
+    return rate;
+}
+
+int AnalyserCore::sourceChannels()
+{
+    // the decoded format before audioconvert mixes it to the analysis channels
+    gint channels = 0;
+    GstPad *pad = gst_element_get_static_pad (p->conv, "sink");
+    GstCaps *caps = gst_pad_get_current_caps (pad);
+    if ( caps ) {
+        gst_structure_get_int (gst_caps_get_structure (caps, 0), "channels", &channels);
+        gst_caps_unref (caps);
+    }
+    gst_object_unref (pad);
+    return channels;
+}
+
+float AnalyserCore::resolution()
+{
+    return  p->fft_res;
+}
+
+int AnalyserCore::bpm()
+{
+    return  p->bpm;
+}
+
+FloatSpan AnalyserCore::peaks()
+{
+    return  p->envelope.peaks();
+}
+
+double AnalyserCore::gainDB()
+{
+    return  m_GainDB;
+}
+
+double AnalyserCore::gainFactor()
+{
+    return pow (10, m_GainDB / 20);
+}
+
+QTime AnalyserCore::startPosition()
+{
+    return m_StartPosition;
+}
+
+QTime AnalyserCore::endPosition()
+{
+    return m_EndPosition;
+}
+
+void AnalyserCore::setPosition(QTime position)
+{
+        int time_milliseconds=QTime(0,0).msecsTo(position);
+        gint64 time_nanoseconds=( time_milliseconds * GST_MSECOND );
+        gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH,
+                                 GST_SEEK_TYPE_SET, time_nanoseconds,
+                                 GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+        qDebug() << Q_FUNC_INFO <<":"<<" position="<<position;
+}
+
+void AnalyserCore::open(QUrl url)
+{
+    //To avoid delays load track in another thread
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" url="<<url;
+
+    stopSource();
+    stopChunks();
+
+    // known results need no decoding at all
+    if ( p->cache && openCached(url) )
+        return;
+
+    // uncompressed files need no pipeline either
+    if ( p->pcmFastPath && openPcm(url) )
+        return;
+
+    QFuture<void> future = QtConcurrent::run( this, &AnalyserCore::asyncOpen,url);
+    p->watcher.setFuture(future);
+}
+
+void AnalyserCore::asyncOpen(QUrl url)
+{
+    p->mutex.lock();
+    qint64 opened = AnalysisStats::now();
+
+    // READY is enough to change the location, all elements stay as they are
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    resetTrack();
+    p->file = url.toLocalFile();
+    // a tempo scan needs neither gain nor silence
+    linkAudioBin();
+    p->measureLoudness = p->analysisMode != TEMPO && !p->elementsLinked;
+
+    GstElement *l_src = gst_bin_get_by_name(GST_BIN(pipeline), "localsrc");
+    g_object_set (G_OBJECT (l_src), "location", (const char*)url.toLocalFile().toUtf8(), NULL);
+
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_PAUSED);
+    p->stats.ns[AnalysisStats::OPEN] = AnalysisStats::now() - opened;
+
+    gst_object_unref(l_src);
+    p->mutex.unlock();
+}
+
+bool AnalyserCore::openCached(QUrl url)
+{
+    ResultCache::Result result;
+    if ( !p->cache->lookup(url.toLocalFile(), cacheParameters(), &result) )
+        return false;
+
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" cached bpm="<<result.bpm;
+    QMutexLocker locker(&p->mutex);
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    resetTrack();
+    p->file = url.toLocalFile();
+    p->cached = true;
+    p->bpm = result.bpm;
+    p->confidence = result.confidence;
+    m_GainDB = result.gainDB;
+    m_StartPosition = QTime(0,0).addMSecs(result.startMs);
+    m_EndPosition = QTime(0,0).addMSecs(result.endMs);
+    m_MaxPosition = QTime(0,0).addMSecs(result.lengthMs);
+    p->finishing.store(1);
+    m_finished = true;
+
+    // like a decoded track the results are signalled after open() returned
+    QMetaObject::invokeMethod(this, "finishStored", Qt::QueuedConnection, Q_ARG(int, p->track));
+    return true;
+}
+
+bool AnalyserCore::openPcm(QUrl url)
+{
+    QString fileName = url.toLocalFile();
+    // the elements only exist in the pipeline
+    if ( !PcmFile::isCandidate(fileName) || ( p->gainElements && p->analysisMode != TEMPO ) )
+        return false;
+
+    qint64 opened = AnalysisStats::now();
+    if ( !p->pcm.open(fileName) )
+        return false;
+
+    // without resampling or a channel mix beyond audioconvert's the samples are the same
+    if ( ( p->analysisRate > 0 && p->pcm.rate() != p->analysisRate ) || p->pcm.channels() > 2 ) {
+        qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" "<<p->pcm.rate()<<"Hz,"<<p->pcm.channels()<<"channels need the pipeline";
+        p->pcm.close();
+        return false;
+    }
+
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" pcm"<<p->pcm.rate()<<"Hz,"<<p->pcm.channels()<<"channels,"<<p->pcm.frames()<<"frames";
+    QMutexLocker locker(&p->mutex);
+    prepareSamples(p->pcm.rate(), p->pcm.frames(), p->pcm.channels());
+    p->file = fileName;
+    p->stats.ns[AnalysisStats::OPEN] = AnalysisStats::now() - opened;
+
+    if ( startChunks(p->pcm.frames() / p->pcm.rate()) ) {
+        p->pcm.close();
+        return true;
+    }
+
+    p->sourceTask = QtConcurrent::run( this, &AnalyserCore::analyseSource);
+    return true;
+}
+
+bool AnalyserCore::analyse(const float *data, qint64 frames, int rate, int channels)
+{
+    if ( !data || !openMemory(data, frames, rate, channels) )
+        return false;
+    analyseSource();
+    return true;
+}
+
+bool AnalyserCore::analyseAsync(const float *data, qint64 frames, int rate, int channels)
+{
+    if ( !data || !openMemory(data, frames, rate, channels) )
+        return false;
+    p->sourceTask = QtConcurrent::run( this, &AnalyserCore::analyseSource);
+    return true;
+}
+
+bool AnalyserCore::openMemory(const float *data, qint64 frames, int rate, int channels)
+{
+    stopSource();
+    if ( frames < 0 || rate <= 0 || channels < 1 || channels > 2 )
+        return false;
+
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" "<<rate<<"Hz,"<<channels<<"channels,"<<frames<<"frames";
+    QMutexLocker locker(&p->mutex);
+    prepareSamples(rate, frames, channels);
+    p->memory = data;
+    p->memoryChannels = channels;
+    return true;
+}
+
+bool AnalyserCore::beginStream(int rate, int channels)
+{
+    if ( !openMemory(0, 0, rate, channels) )
+        return false;
+    p->startedAt = AnalysisStats::now();
+    return true;
+}
+
+void AnalyserCore::pushSamples(const float *data, int frames)
+{
+    // only between beginStream() and endStream()
+    if ( m_finished || p->memory || p->memoryChannels == 0 || frames <= 0 )
+        return;
+    feedSamples(data, p->memoryChannels, frames);
+    p->sourceFrames += frames;
+}
+
+void AnalyserCore::endStream()
+{
+    if ( m_finished || p->memory || p->memoryChannels == 0 )
+        return;
+    m_MaxPosition = QTime(0,0).addMSecs(p->sourceFrames * 1000 / p->rate);
+    m_EndPosition = m_MaxPosition;
+    need_finish();
+}
+
+void AnalyserCore::prepareSamples(int rate, qint64 frames, int sourceChannels)
+{
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    resetTrack();
+    p->measureLoudness = p->analysisMode != TEMPO;
+    p->sourceFrames = frames;
+
+    // what the caps of the sink would have said
+    int channels = p->mono ? 1 : 2;
+    p->channels = channels;
+    if ( rate != p->rate )
+        configureRate(rate);
+    if ( rate != p->loudness.rate() || channels != p->loudness.channels() )
+        p->loudness.setup(rate, channels);
+    p->loudness.setSourceChannels(sourceChannels);
+    if ( p->pipelined && channels != p->ring.channels() )
+        resetRing(channels);
+    m_MaxPosition = QTime(0,0).addMSecs(frames * 1000 / rate);
+    m_EndPosition = m_MaxPosition;
+}
+
+void AnalyserCore::analyseSource()
+{
+    int rate = p->rate;
+    qint64 frames = p->sourceFrames;
+
+    // a part of a chunked track
+    if ( p->rangeFirst >= 0 ) {
+        qint64 last = p->rangeLast < 0 ? frames : qMin(p->rangeLast, frames);
+        p->envelope.reserve( ( last - p->rangeFirst ) / p->hop + 1 );
+        p->startedAt = AnalysisStats::now();
+        p->firstSample = p->rangeFirst;
+        readSource(p->rangeFirst, last - p->rangeFirst);
+        p->pcm.close();
+        need_finish();
+        return;
+    }
+
+    int seconds = planScanWindows( frames / rate );
+    p->envelope.reserve( ( seconds + 1 ) * p->fft_res );
+    p->startedAt = AnalysisStats::now();
+
+    if ( p->scanStarts.isEmpty() )
+        readSource(0, frames);
+    for ( int i = 0; i < p->scanStarts.count(); i++ ) {
+        if ( i > 0 ) {
+            if ( p->pipelined )
+                p->ring.drain();
+            stitchScanWindow();
+        }
+        qint64 first = (qint64)QTime(0,0).msecsTo(p->scanStarts.at(i)) * rate / 1000;
+        readSource(first, qMin<qint64>((qint64)p->scanDuration * rate, frames - first));
+    }
+
+    p->pcm.close();
+    need_finish();
+}
+
+void AnalyserCore::readSource(qint64 first, qint64 count)
+{
+    if ( p->memory ) {
+        feedSamples(p->memory + first * p->memoryChannels, p->memoryChannels, count);
+        return;
+    }
+
+    // a chunk of floats stands in for a decoded buffer
+    if ( p->pcmBuffer.size() < PCM_CHUNK_FRAMES * p->channels ) {
+        p->pcmBuffer.resize(PCM_CHUNK_FRAMES * p->channels);
+        p->stats.allocations++;
+    }
+    float *buffer = p->pcmBuffer.data();
+
+    for ( qint64 done = 0; done < count && !p->stopping.load(); ) {
+        int frames = p->pcm.read(first + done, (int)qMin<qint64>(PCM_CHUNK_FRAMES, count - done), buffer, p->channels);
+        if ( frames <= 0 )
+            break;
+        p->stats.bytes += (qint64)frames * p->pcm.frameBytes();
+        deliverSamples(buffer, frames);
+        done += frames;
+    }
+}
+
+void AnalyserCore::feedSamples(const float *data, int channels, qint64 count)
+{
+    // the caller's samples are used in place, unless the channels need a mix
+    if ( channels != p->channels && p->pcmBuffer.size() < PCM_CHUNK_FRAMES * p->channels ) {
+        p->pcmBuffer.resize(PCM_CHUNK_FRAMES * p->channels);
+        p->stats.allocations++;
+    }
+
+    for ( qint64 done = 0; done < count && !p->stopping.load(); ) {
+        int frames = (int)qMin<qint64>(PCM_CHUNK_FRAMES, count - done);
+        const float *chunk = data + done * channels;
+        if ( channels != p->channels ) {
+            PcmFile::mixChannels(chunk, channels, frames, p->pcmBuffer.data(), p->channels);
+            chunk = p->pcmBuffer.constData();
+        }
+        p->stats.bytes += (qint64)frames * channels * sizeof(float);
+        deliverSamples(chunk, frames);
+        done += frames;
+    }
+}
+
+void AnalyserCore::deliverSamples(const float *data, int frames)
+{
+    p->stats.buffers++;
+    if ( p->pipelined )
+        p->ring.write(data, frames, p->stopping);
+    else
+        samplesReceived(data, frames);
+}
+
+void AnalyserCore::stopSource()
+{
+    // the last samples of a track still in conversion are of no use anymore
+    if ( p->sourceTask.isRunning() ) {
+        p->stopping.store(1);
+        p->sourceTask.waitForFinished();
+    }
+}
+
+void AnalyserCore::setPcmFastPath(bool enabled)
+{
+    p->pcmFastPath = enabled;
+}
+
+void AnalyserCore::setRawFormat(int rate, int channels, int type, bool bigEndian)
+{
+    p->rawRate = rate;
+    p->rawChannels = channels;
+    p->rawType = type;
+    p->rawBigEndian = bigEndian;
+    p->pcm.setRawFormat(rate, channels, (PcmFile::sampleType)type, bigEndian);
+}
+
+void AnalyserCore::finishStored(int track)
+{
+    if ( track != p->track )
+        return;
+
+    Q_EMIT finishGain();
+    Q_EMIT finishTempo();
+}
+
+bool AnalyserCore::openEnvelope(const QString &fileName)
+{
+    EnvelopeFile file;
+    if ( !file.open(fileName) )
+        return false;
+
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" envelope="<<fileName<<file.frames()<<"frames";
+    QMutexLocker locker(&p->mutex);
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    resetTrack();
+
+    // the tempo runs on the envelope in the file, only the peaks need room here
+    p->fft_res = file.frameRate();
+    p->envelope.reserve(file.frames());
+    FloatSpan bands[SpectralFlux::BAND_COUNT];
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        bands[b] = file.band(b);
+    float bpm = detectTempo( bands );
+    p->bpm = qRound(bpm);
+    trackBeats( bands, bpm );
+    p->finishing.store(1);
+    m_finished = true;
+
+    QMetaObject::invokeMethod(this, "finishStored", Qt::QueuedConnection, Q_ARG(int, p->track));
+    return true;
+}
+
+void AnalyserCore::setEnvelopeFile(const QString &fileName, int flags)
+{
+    p->envelopeFile = fileName;
+    p->envelopeFlags = flags;
+}
+
+QByteArray AnalyserCore::cacheParameters()
+{
+    // everything which changes the results of a track
+    QByteArray parameters = "v" + QByteArray::number(RESULT_VERSION);
+    parameters += " preset=" + QByteArray::number(p->engine->fftSize()) + "/" + QByteArray::number(p->engine->bands());
+    parameters += " rate=" + QByteArray::number(p->analysisRate) + (p->mono ? "m" : "s");
+    parameters += " median=" + QByteArray::number(p->medianThreshold);
+    parameters += " octave=" + QByteArray::number(p->octaveCorrection);
+    parameters += " gain=" + QByteArray(p->gainElements && p->analysis ? "elements" : "r128");
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        parameters += (b ? "," : " weights=") + QByteArray::number(p->bandWeights[b]);
+    if ( p->analysisMode == TEMPO )
+        parameters += " scan=" + QByteArray::number(p->scanWindows) + "x" + QByteArray::number(p->scanDuration);
+    if ( p->earlyStopSecs > 0 )
+        parameters += " early=" + QByteArray::number(p->earlyStopSecs) + "/" + QByteArray::number(p->earlyStopConfidence);
+    return parameters;
+}
+
+void AnalyserCore::setCache(ResultCache *cache)
+{
+    p->cache = cache;
+}
+
+bool AnalyserCore::cached()
+{
+    return p->cached;
+}
+
+void AnalyserCore::reset()
+{
+    stopSource();
+    stopChunks();
+    QMutexLocker locker(&p->mutex);
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    resetTrack();
+}
+
+void AnalyserCore::resetTrack()
+{
+    // forget everything of the previous track, a stored envelope brought its own frame rate
+    p->fft_res = p->engine->frameRate();
+    // the next track may come in another format, its first caps tell
+    gst_caps_replace (&p->sinkCaps, NULL);
+    m_GainDB = GAIN_INVALID;
+    m_StartPosition = QTime(0,0);
+    m_EndPosition = QTime(0,0);
+    m_MaxPosition = QTime(0,0);
+    m_finished = false;
+    p->cached = false;
+    p->failed = false;
+    p->bpm = 0;
+    p->confidence = 0;
+    p->stableFrames = 0;
+    p->finishing.store(0);
+    p->stopping.store(0);
+    p->track++;
+    p->scanStarts.clear();
+    p->scanIndex = 0;
+    p->scanBoundary.store(0);
+    p->skipFrames = 0;
+    if ( p->onlineMode )
+        p->online.setup(p->fft_res);
+    // the analysis thread may still work on the last samples of the previous track
+    if ( p->pipelined ) {
+        p->ring.park();
+        p->ring.clear();
+        p->ring.unpark();
+    } else
+        p->ring.clear();
+    p->engine->reset();
+    p->beatTracker.clear();
+    p->stats.clear();
+    p->startedAt = 0;
+    p->memory = 0;
+    p->memoryChannels = 0;
+    p->firstSample = -1;
+    p->dropFrames = 0;
+    p->loudness.clear();
+    p->carryFrames = 0;
+    p->envelope.clear();
+}
+
+void AnalyserCore::loadThreadFinished()
+{
+    // async load in player done
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" analysisMode="<<p->analysisMode;
+
+    m_EndPosition=length();
+    int seconds = QTime(0,0).msecsTo(length()) / 1000;
+
+    // the pipeline is prerolled, so the analysis rate is known now
+    int rate = negotiatedRate();
+    if ( rate > 0 && rate != p->rate )
+        configureRate(rate);
+
+    if ( p->rangeFirst >= 0 ) {
+        seekRange();
+        seconds = ( ( p->rangeLast < 0 ? (qint64)seconds * p->rate : p->rangeLast ) - p->rangeFirst ) / p->rate;
+    }
+    else if ( startChunks(seconds) )
+        return;
+
+    seconds = planScanWindows(seconds);
+    if ( !p->scanStarts.isEmpty() )
+        seekScanWindow(0);
+
+    // size the envelope for the whole track at once, a second more for rounding
+    p->envelope.reserve( ( seconds + 1 ) * p->fft_res );
+    start();
+}
+
+void AnalyserCore::setChunking(int chunks, int minSeconds)
+{
+    p->chunks = chunks;
+    p->chunkSeconds = minSeconds;
+}
+
+bool AnalyserCore::startChunks(int seconds)
+{
+    int chunks = p->chunks > 0 ? p->chunks : QThread::idealThreadCount();
+    chunks = qMin(chunks, seconds / CHUNK_MIN_SECONDS);
+    // sampled scans, online estimates and the gain elements need the track in one piece
+    if ( chunks < 2 || p->chunkSeconds <= 0 || seconds < p->chunkSeconds || p->rangeFirst >= 0
+         || p->analysisMode == TEMPO || p->onlineMode || p->gainElements || p->file.isEmpty() )
+        return false;
+
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<seconds<<"s in"<<chunks<<"chunks";
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    p->startedAt = AnalysisStats::now();
+
+    // the parts own whole frames of the envelope, each one decodes a lead-in before
+    // its first frame and a tail after its last, the merge drops both again
+    qint64 frames = (qint64)( seconds + 1 ) * p->rate / p->hop;
+    qint64 preroll = (qint64)ceil( CHUNK_PREROLL_SECONDS * p->fft_res ) * p->hop;
+    qint64 tail = (qint64)CHUNK_TAIL_SECONDS * p->rate;
+    p->envelope.reserve( frames + 1 );
+    p->chunkFrames.resize(chunks + 1);
+    for ( int k = 0; k <= chunks; k++ )
+        p->chunkFrames[k] = frames * k / chunks;
+
+    while ( p->chunkCores.count() < chunks ) {
+        AnalyserCore *core = new AnalyserCore();
+        core->setObjectName(QString("%1/chunk%2").arg(objectName()).arg(p->chunkCores.count()));
+        connect(core, SIGNAL(finishTempo()), this, SLOT(chunkFinished()), Qt::QueuedConnection);
+        p->chunkCores.append(core);
+    }
+
+    // all parts stop being finished before any of them can report
+    for ( int k = 0; k < chunks; k++ )
+        p->chunkCores.at(k)->reset();
+
+    p->chunksUsed = chunks;
+    p->chunking = true;
+    QUrl url = QUrl::fromLocalFile(p->file);
+    for ( int k = 0; k < chunks; k++ ) {
+        AnalyserCore *core = p->chunkCores.at(k);
+        core->setAnalysisRate(p->analysisRate, p->mono);
+        core->setPreset(p->preset);
+        core->setMode(STANDARD);
+        core->setPcmFastPath(p->pcmFastPath);
+        core->setInstrumentation(p->instrumented);
+        core->setRawFormat(p->rawRate, p->rawChannels, p->rawType, p->rawBigEndian);
+        core->p->rangeFirst = k == 0 ? 0 : qMax<qint64>(0, p->chunkFrames[k] * p->hop - preroll);
+        core->p->rangeLast = k == chunks - 1 ? -1 : p->chunkFrames[k + 1] * p->hop + tail;
+        core->open(url);
+    }
+    return true;
+}
+
+void AnalyserCore::stopChunks()
+{
+    if ( !p->chunking )
+        return;
+    p->chunking = false;
+    for ( int k = 0; k < p->chunksUsed; k++ )
+        p->chunkCores.at(k)->reset();
+}
+
+void AnalyserCore::seekRange()
+{
+    gint64 start_ns = gst_util_uint64_scale (p->rangeFirst, GST_SECOND, p->rate);
+    gint64 stop_ns = p->rangeLast < 0 ? -1 : gst_util_uint64_scale (p->rangeLast, GST_SECOND, p->rate);
+
+    // like a scan window the part ends with SEGMENT_DONE
+    gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+                      (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_ACCURATE),
+                      GST_SEEK_TYPE_SET, start_ns,
+                      p->rangeLast < 0 ? GST_SEEK_TYPE_NONE : GST_SEEK_TYPE_SET, stop_ns);
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" samples"<<p->rangeFirst<<"to"<<p->rangeLast;
+}
+
+void AnalyserCore::chunkFinished()
+{
+    if ( !p->chunking )
+        return;
+    for ( int k = 0; k < p->chunksUsed; k++ )
+        if ( !p->chunkCores.at(k)->finished() )
+            return;
+
+    p->chunking = false;
+    mergeChunks();
+    need_finish();
+}
+
+void AnalyserCore::mergeChunks()
+{
+    float silence[SpectralFlux::BAND_COUNT] = {0, 0, 0, 0};
+    float flux[SpectralFlux::BAND_COUNT];
+    p->envelope.clear();
+
+    for ( int k = 0; k < p->chunksUsed; k++ ) {
+        AnalyserCore_Private *part = p->chunkCores.at(k)->p;
+        if ( part->failed )
+            p->failed = true;
+
+        // frame j of the part is the frame base + j of the track
+        qint64 firstSample = part->firstSample >= 0 ? part->firstSample : part->rangeFirst;
+        qint64 base = firstSample / p->hop;
+        qint64 own = p->chunkFrames[k];
+        bool last = k == p->chunksUsed - 1;
+        qint64 end = last ? LLONG_MAX : p->chunkFrames[k + 1];
+        int frames = part->envelope.frames();
+        for ( qint64 j = qMax<qint64>(0, own - base); j < frames && base + j < end; j++ ) {
+            // a part which came up short leaves a silent gap, the time line stays right
+            while ( p->envelope.frames() < base + j )
+                p->envelope.append( silence );
+            if ( p->envelope.frames() > base + j )
+                continue;
+            for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+                flux[b] = part->envelope.band(b)[j];
+            p->envelope.append( flux );
+        }
+
+        p->loudness.merge(part->loudness, firstSample, own * p->hop - firstSample,
+                          last ? LLONG_MAX : end * p->hop - firstSample);
+        p->stats.buffers += part->stats.buffers;
+        p->stats.bytes += part->stats.bytes;
+        p->stats.frames += part->stats.frames;
+        p->stats.allocations += part->stats.allocations;
+        // the parts ran side by side, their stages add up like the time of their threads
+        const int stages[] = { AnalysisStats::DECODE, AnalysisStats::DOWNMIX, AnalysisStats::FFT,
+                               AnalysisStats::FLUX, AnalysisStats::LOUDNESS };
+        for ( unsigned s = 0; s < sizeof(stages) / sizeof(stages[0]); s++ )
+            p->stats.ns[stages[s]] += part->stats.ns[stages[s]];
+    }
+    // the parts timed their decoding themselves
+    p->startedAt = 0;
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<p->envelope.frames()<<"frames from"<<p->chunksUsed<<"chunks";
+}
+
+int AnalyserCore::planScanWindows(int seconds)
+{
+    // a sampled scan only pays off if the windows leave something out
+    if ( p->analysisMode != AnalyserCore::TEMPO || seconds <= p->scanWindows * p->scanDuration )
+        return seconds;
+
+    for ( int i = 0; i < p->scanWindows; i++ ) {
+        int offset = p->scanWindows > 1 ? ( seconds - p->scanDuration ) * i / ( p->scanWindows - 1 ) : 0;
+        p->scanStarts.append( QTime(0,0).addSecs(offset) );
+    }
+    // the seconds to reserve the envelope for, with the gaps of the harmonic lags at 60 bpm
+    return p->scanWindows * ( p->scanDuration + BandTempo::HARMONICS + 1 );
+}
+
+void AnalyserCore::setMode(modeType mode)
+{
+    p->analysisMode = mode;
+}
+
+void AnalyserCore::setScanWindows(int windows, int seconds)
+{
+    p->scanWindows = qMax(1, windows);
+    p->scanDuration = qMax(1, seconds);
+}
+
+void AnalyserCore::seekScanWindow(int index)
+{
+    QTime start = p->scanStarts.at(index);
+    gint64 start_ns = QTime(0,0).msecsTo(start) * GST_MSECOND;
+    gint64 stop_ns = start_ns + p->scanDuration * GST_SECOND;
+
+    // a segment seek ends with SEGMENT_DONE instead of EOS, so the next window can follow
+    gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+                      (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_ACCURATE),
+                      GST_SEEK_TYPE_SET, start_ns,
+                      GST_SEEK_TYPE_SET, stop_ns);
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" window"<<index<<" start="<<start;
+}
+
+void AnalyserCore::nextScanWindow(int track)
+{
+    if ( track != p->track || m_finished )
+        return;
+
+    p->scanIndex++;
+    if ( p->scanIndex < p->scanStarts.count() ) {
+        // the streaming thread stitches the envelope when the new window arrives
+        p->scanBoundary.store(1);
+        seekScanWindow(p->scanIndex);
+    }
+    else {
+        sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+        need_finish();
+    }
+}
+
+void AnalyserCore::start()
+{
+    qDebug() << Q_FUNC_INFO <<":"<<objectName();
+    p->startedAt = AnalysisStats::now();
+    gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_PLAYING);
+}
+
+
+bool AnalyserCore::close()
+{
+    gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_NULL);
+    return true;
+}
+
+
+QTime AnalyserCore::length()
+{
+    if (pipeline) {
+
+        gint64 value=0;
+
+#ifdef GST_API_VERSION_1
+        if(gst_element_query_duration(pipeline, GST_FORMAT_TIME, &value)) {
+#else
+        GstFormat fmt = GST_FORMAT_TIME;
+        if(gst_element_query_duration(pipeline, &fmt, &value)) {
+#endif
+            //qDebug() << Q_FUNC_INFO <<  " new value:" <<value;
+            m_MaxPosition = QTime(0,0).addMSecs( static_cast<uint>( ( value / GST_MSECOND ) )); // nanosec -> msec
+        }
+    }
+    //qDebug() << Q_FUNC_INFO <<  " return:" <<m_MaxPosition;
+    return m_MaxPosition;
+}
+
+void AnalyserCore::dataReceived(GstSample *sample)
+{
+    GstMapInfo map;
+    GstBuffer *buffer = gst_sample_get_buffer (sample);
+    GstCaps *caps = gst_sample_get_caps (sample);
+
+        if ( p->stopping.load() || !buffer || !caps ) return;
+
+        // the format only changes with new caps, not with every buffer
+        if ( caps != p->sinkCaps ) {
+            gint channels = 0, rate = 0;
+            GstStructure *structure = gst_caps_get_structure (caps, 0);
+            gst_structure_get_int (structure, "channels", &channels);
+            gst_structure_get_int (structure, "rate", &rate);
+            if ( p->pipelined )
+                p->ring.drain();
+            gst_caps_replace (&p->sinkCaps, caps);
+            if ( channels != p->channels )
+                p->carryFrames = 0;
+            p->channels = channels;
+            if ( rate > 0 && rate != p->rate ) configureRate(rate);
+            if ( rate > 0 && channels > 0 && ( rate != p->loudness.rate() || channels != p->loudness.channels() ) )
+                p->loudness.setup(rate, channels);
+            p->loudness.setSourceChannels(sourceChannels());
+            if ( p->pipelined && channels > 0 && channels != p->ring.channels() )
+                resetRing(channels);
+        }
+        if ( p->channels <= 0 ) return;
+
+        if ( p->scanBoundary.testAndSetOrdered(1, 0) ) {
+            if ( p->pipelined )
+                p->ring.drain();
+            stitchScanWindow();
+        }
+
+        // where a part of a chunked track really starts, after the seek
+        // where a part of a chunked track really starts after the seek, its frames begin
+        // with the next hop of the track so they sit on the grid of a single pass
+        if ( p->rangeFirst >= 0 && p->firstSample < 0 ) {
+            qint64 first = GST_BUFFER_PTS_IS_VALID (buffer)
+                    ? gst_util_uint64_scale_round (GST_BUFFER_PTS (buffer), p->rate, GST_SECOND) : p->rangeFirst;
+            p->firstSample = ( first + p->hop - 1 ) / p->hop * p->hop;
+            p->dropFrames = p->firstSample - first;
+        }
+
+        if ( !gst_buffer_map (buffer, &map, GST_MAP_READ) ) return;
+        const float *data = (const float *)map.data;
+        int frames = map.size / (p->channels * sizeof (gfloat));
+        p->stats.buffers++;
+        p->stats.bytes += map.size;
+        if ( p->dropFrames > 0 ) {
+            int dropped = qMin(p->dropFrames, frames);
+            data += dropped * p->channels;
+            frames -= dropped;
+            p->dropFrames -= dropped;
+        }
+        // pipelined the streaming thread only copies, a full ring holds the decoder back
+        if ( frames > 0 && p->pipelined )
+            p->ring.write(data, frames, p->stopping);
+        else if ( frames > 0 )
+            samplesReceived(data, frames);
+        gst_buffer_unmap (buffer, &map);
+}
+
+void AnalyserCore::consumeSamples()
+{
+    while ( !p->quit.load() ) {
+        int frames;
+        const float *data = p->ring.peek(&frames);
+        if ( frames == 0 ) {
+            p->ring.waitForData(10);
+            continue;
+        }
+        if ( !p->stopping.load() )
+            samplesReceived(data, frames);
+        p->ring.consume(frames);
+    }
+}
+
+void AnalyserCore::setPipelined(bool pipelined)
+{
+    QMutexLocker locker(&p->mutex);
+    if ( pipelined == p->pipelined )
+        return;
+
+    p->pipelined = pipelined;
+    if ( pipelined ) {
+        // the format is known with the first caps, a new one forces a reset there
+        if ( p->channels > 0 )
+            p->ring.reset(p->channels, RING_FRAMES);
+        p->quit.store(0);
+        p->analysisThread = new AnalysisThread(this);
+        p->analysisThread->start();
+    } else {
+        p->quit.store(1);
+        p->analysisThread->wait();
+        delete p->analysisThread;
+        p->analysisThread = 0;
+    }
+}
+
+void AnalyserCore::resetRing(int channels)
+{
+    // the analysis thread must not look into the ring while it is reallocated
+    p->ring.park();
+    p->ring.reset(channels, RING_FRAMES);
+    p->ring.unpark();
+}
+
+SampleRing::Stats AnalyserCore::ringStats()
+{
+    return p->ring.stats();
+}
+
+void AnalyserCore::samplesReceived(const float *data, int frames)
+{
+    int channels = p->channels;
+    int fft_size = p->engine->fftSize();
+    int hop = p->hop;
+    int window = qMax(hop, fft_size);
+
+    // the scratch buffers only grow with the window, never per frame
+    if ( window * channels > p->frameSize ) {
+        p->stats.allocations += 3;
+        float *carry = (float *)g_malloc (window * channels * sizeof (gfloat));
+        if ( p->carryFrames > 0 )
+            memcpy (carry, p->carry, p->carryFrames * channels * sizeof (gfloat));
+        g_free (p->carry);
+        g_free (p->frame);
+        g_free (p->mono);
+        p->carry = carry;
+        p->frame = (float *)g_malloc (window * channels * sizeof (gfloat));
+        p->mono = (float *)g_malloc (window * sizeof (gfloat));
+        p->frameSize = window * channels;
+    }
+    // gain and silence see every sample once, while they are still in the cache
+    if ( p->measureLoudness ) {
+        if ( p->instrumented ) {
+            qint64 begin = AnalysisStats::now();
+            p->loudness.process(data, frames);
+            p->stats.ns[AnalysisStats::LOUDNESS] += AnalysisStats::now() - begin;
+        } else
+            p->loudness.process(data, frames);
+    }
+
+    // a smaller window after a new rate or preset
+    if ( p->carryFrames >= window )
+        p->carryFrames = 0;
+
+    // the frames run over the carry-over of the last buffer followed by this one
+    int carried = p->carryFrames;
+    int total = carried + frames;
+    int start = 0;
+    while ( start + window <= total ) {
+        const float *frame;
+        if ( start >= carried ) {
+            // completely inside the mapped buffer, no copy
+            frame = data + (start - carried) * channels;
+        } else {
+            int head = carried - start;
+            memcpy (p->frame, p->carry + start * channels, head * channels * sizeof (gfloat));
+            memcpy (p->frame + head * channels, data, (window - head) * channels * sizeof (gfloat));
+            frame = p->frame;
+        }
+
+        if ( p->instrumented ) {
+            qint64 begin = AnalysisStats::now();
+            SpectralFlux::downmix(frame, channels, fft_size, p->mono);
+            p->stats.ns[AnalysisStats::DOWNMIX] += AnalysisStats::now() - begin;
+        } else
+            SpectralFlux::downmix(frame, channels, fft_size, p->mono);
+        float flux[SpectralFlux::BAND_COUNT];
+        p->engine->process(p->mono, flux);
+        p->stats.frames++;
+        if ( p->skipFrames > 0 )
+            p->skipFrames--;
+        else {
+            // a full envelope grows on this append
+            if ( p->envelope.frames() == p->envelope.capacity() )
+                p->stats.allocations++;
+            p->envelope.append( flux );
+            if ( p->onlineMode )
+                onlineUpdate( flux[SpectralFlux::ALL] );
+        }
+
+        start += hop;
+    }
+
+    // keep what the next frame still needs, less than one window
+    if ( start < carried ) {
+        memmove (p->carry, p->carry + start * channels, (carried - start) * channels * sizeof (gfloat));
+        memcpy (p->carry + (carried - start) * channels, data, frames * channels * sizeof (gfloat));
+    } else {
+        memcpy (p->carry, data + (start - carried) * channels, (total - start) * channels * sizeof (gfloat));
+    }
+    p->carryFrames = total - start;
+}
+
+void AnalyserCore::messageReceived(GstMessage *message)
+{
+        switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ERROR: {
+                GError *err;
+                gchar *debug;
+                gst_message_parse_error (message, &err, &debug);
+                QString str;
+                str = "Error #"+QString::number(err->code)+" in module "+QString::number(err->domain)+"\n"+QString::fromUtf8(err->message);
+                if(err->code == 6 && err->domain == 851) {
+                        str += "\nMay be you should to install gstreamer0.10-plugins-ugly or gstreamer0.10-plugins-bad";
+                }
+                qDebug()<< "Gstreamer error:"<< str;
+                g_error_free (err);
+                g_free (debug);
+                p->failed = true;
+                need_finish();
+                break;
+        }
+        case GST_MESSAGE_SEGMENT_DONE:{
+                // sampled scan: seeks are not allowed from the streaming thread
+                QMetaObject::invokeMethod(this, "nextScanWindow", Qt::QueuedConnection, Q_ARG(int, p->track));
+                break;
+        }
+        case GST_MESSAGE_EOS:{
+                qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" End of track reached";
+                need_finish();
+                break;
+        }
+        case GST_MESSAGE_ELEMENT:{
+
+                const GstStructure *s = gst_message_get_structure (message);
+                const gchar *name = gst_structure_get_name (s);
+                GstClockTime timestamp;
+                gst_structure_get_clock_time (s, "timestamp", &timestamp);
+
+                // data for Start and End time detection
+                if (strcmp (name, "cutter") == 0) {
+
+                    const GValue *value;
+                    value=gst_structure_get_value (s, "above");
+                    bool isSilent=!g_value_get_boolean(value);
+
+                    //if we detect a falling edge, set EndPostion to this
+                    if (isSilent)
+                        m_EndPosition=QTime(0,0).addMSecs( static_cast<uint>( ( timestamp / GST_MSECOND ) )); // nanosec -> msec
+                    else
+                    {
+                        //if this is the first rising edge, set StartPosition
+                        if (m_StartPosition==QTime(0,0) && m_EndPosition==m_MaxPosition)
+                            m_StartPosition=QTime(0,0).addMSecs( static_cast<uint>( ( timestamp / GST_MSECOND ) )); // nanosec -> msec
+
+                        //if we detect a rising edge, set EndPostion to track end
+                        m_EndPosition=length();
+                    }
+                    //qDebug() << Q_FUNC_INFO <<QTime(0,0).addMSecs( static_cast<uint>( ( timestamp / GST_MSECOND ) ))<< " silent:" << isSilent;
+                }
+            break;
+          }
+
+        case GST_MESSAGE_TAG:{
+
+                GstTagList *tags = NULL;
+                gst_message_parse_tag (message, &tags);
+                if (gst_tag_list_get_double (tags, GST_TAG_TRACK_GAIN, &m_GainDB))
+                {
+                    qDebug() << Q_FUNC_INFO << ": Gain-db:" << m_GainDB;
+                    qDebug() << Q_FUNC_INFO << ": Gain-norm:" << pow (10, m_GainDB / 20);
+                }
+            }
+
+        default:
+                break;
+        }
+
+}
+
+void AnalyserCore::stitchScanWindow()
+{
+    // samples left from the last window do not belong to this one
+    p->carryFrames = 0;
+
+    // the correlation and the octave pulses reach the harmonics of the longest lag,
+    // a silent gap of that length keeps products across windows out of all of them
+    float silence[SpectralFlux::BAND_COUNT] = {0, 0, 0, 0};
+    BandTempo range;
+    range.setup(p->fft_res);
+    int gap = BandTempo::HARMONICS * range.maxLag() + 1;
+    for ( int i = 0; i < gap; i++ ) {
+        p->envelope.append( silence );
+        if ( p->onlineMode )
+            onlineUpdate( 0 );
+    }
+
+    // the first frame only refreshes the last spectrum, its flux spans the jump
+    p->skipFrames = 1;
+}
+
+void AnalyserCore::onlineUpdate(float flux)
+{
+    p->online.push(flux);
+    if ( p->online.frames() % p->onlineInterval != 0 )
+        return;
+
+    p->online.estimate();
+    int bpm = qRound(p->online.bpm());
+    float confidence = p->online.confidence();
+
+    // how long the estimate stayed the same
+    if ( bpm > 0 && bpm == p->bpm && confidence >= p->earlyStopConfidence )
+        p->stableFrames += p->onlineInterval;
+    else
+        p->stableFrames = 0;
+
+    p->bpm = bpm;
+    p->confidence = confidence;
+    Q_EMIT tempoEstimate(bpm, confidence);
+
+    if ( p->earlyStopSecs > 0 && p->stableFrames >= p->earlyStopSecs * p->fft_res
+         && p->stopping.testAndSetOrdered(0, 1) ) {
+        qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" tempo settled at"<<bpm<<"after"<<p->online.frames() / p->fft_res<<"s";
+        // state changes are not allowed from the streaming thread
+        QMetaObject::invokeMethod(this, "stopEarly", Qt::QueuedConnection, Q_ARG(int, p->track));
+    }
+}
+
+void AnalyserCore::stopEarly(int track)
+{
+    // a new track may have been opened in the meantime
+    if ( track != p->track || m_finished )
+        return;
+
+    sync_set_state (GST_ELEMENT (pipeline), GST_STATE_READY);
+    need_finish();
+}
+
+void AnalyserCore::setOnline(bool online, int intervalMs)
+{
+    p->onlineMode = online;
+    p->onlineIntervalMs = intervalMs;
+    p->onlineInterval = qMax(1, qRound(intervalMs * p->fft_res / 1000));
+}
+
+void AnalyserCore::setEarlyStop(int stableSecs, float minConfidence)
+{
+    p->earlyStopSecs = stableSecs;
+    p->earlyStopConfidence = minConfidence;
+    if ( stableSecs > 0 && !p->onlineMode )
+        setOnline(true);
+}
+
+void AnalyserCore::setMedianThreshold(bool median)
+{
+    p->medianThreshold = median;
+}
+
+float AnalyserCore::confidence()
+{
+    return p->confidence;
+}
+
+void AnalyserCore::need_finish()
+{
+    // error, end of stream and an early stop may all end up here
+    if ( !p->finishing.testAndSetOrdered(0, 1) )
+        return;
+
+    // everything decoded so far is analysed before the tempo is detected
+    if ( p->pipelined ) {
+        p->ring.drain();
+        SampleRing::Stats stats = p->ring.stats();
+        qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" ring peak"<<stats.peakFill<<"of"<<p->ring.capacity()
+                 <<"frames, mean fill"<<stats.meanFill<<","<<stats.stalls<<"of"<<stats.writes<<"writes stalled";
+    }
+
+    // what is left of the streaming time went to decoding and conversion
+    if ( p->startedAt > 0 ) {
+        qint64 streaming = AnalysisStats::now() - p->startedAt;
+        if ( !p->pipelined )
+            streaming -= p->stats.ns[AnalysisStats::DOWNMIX] + p->stats.ns[AnalysisStats::FFT]
+                    + p->stats.ns[AnalysisStats::FLUX] + p->stats.ns[AnalysisStats::LOUDNESS];
+        p->stats.ns[AnalysisStats::DECODE] = qMax(0LL, (long long)streaming);
+    }
+
+    // a part of a chunked track ends with its envelope, the rest is up to the whole track
+    if ( p->rangeFirst >= 0 ) {
+        m_finished=true;
+        Q_EMIT finishTempo();
+        return;
+    }
+
+    // the sound starts the same in a part of the track, gain and end need all of it
+    if ( p->measureLoudness && !p->failed && p->loudness.hasSound() ) {
+        QTime zero(0,0);
+        m_StartPosition = zero.addMSecs(p->loudness.soundStartMs());
+        if ( !p->stopping.load() ) {
+            m_GainDB = p->loudness.gainDB(GAIN_INVALID);
+            m_EndPosition = zero.addMSecs(p->loudness.soundEndMs());
+        }
+        qDebug() << Q_FUNC_INFO <<":"<<objectName()<<" loudness"<<p->loudness.loudness()<<"LUFS, gain"<<m_GainDB<<"dB";
+    }
+
+    m_finished=true;
+    Q_EMIT finishGain();
+
+    FloatSpan bands[SpectralFlux::BAND_COUNT];
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        bands[b] = p->envelope.band(b);
+    float bpm = detectTempo( bands );
+    p->bpm = qRound(bpm);
+
+    // the windows of a sampled scan are no continuous time line
+    if ( p->analysisMode != TEMPO )
+        trackBeats( bands, bpm );
+
+    if ( !p->envelopeFile.isEmpty() && !p->failed )
+        EnvelopeFile::write(p->envelopeFile, p->envelope, p->fft_res, p->envelopeFlags);
+
+    if ( p->cache && !p->failed && !p->file.isEmpty() ) {
+        QTime zero(0,0);
+        ResultCache::Result result;
+        result.bpm = p->bpm;
+        result.confidence = p->confidence;
+        result.gainDB = m_GainDB;
+        result.startMs = zero.msecsTo(m_StartPosition);
+        result.endMs = zero.msecsTo(m_EndPosition);
+        result.lengthMs = zero.msecsTo(m_MaxPosition);
+        p->cache->store(p->file, cacheParameters(), result);
+    }
+
+    Q_EMIT finishTempo();
+}
+
+void AnalyserCore::trackBeats(const FloatSpan *bands, float bpm)
+{
+    qint64 start = AnalysisStats::now();
+    // kicks mark the first beat of a bar more often than anything else
+    p->beatTracker.track(bands[SpectralFlux::ALL], p->fft_res, bpm, bands[SpectralFlux::BD]);
+    p->stats.ns[AnalysisStats::BEATS] = AnalysisStats::now() - start;
+    qDebug() << Q_FUNC_INFO <<":"<<objectName()<<p->beatTracker.beats().count()<<"beats in"<<p->stats.ns[AnalysisStats::BEATS] / 1000<<"us";
+}
+
+static QList<QTime> framesToTimes(const QVector<int> &frames, float frameRate)
+{
+    QList<QTime> times;
+    if ( frameRate <= 0 )
+        return times;
+    times.reserve(frames.count());
+    for ( int i = 0; i < frames.count(); i++ )
+        times.append(QTime(0,0).addMSecs(qRound(frames.at(i) * 1000.0 / frameRate)));
+    return times;
+}
+
+QList<QTime> AnalyserCore::beats()
+{
+    return framesToTimes(p->beatTracker.beats(), p->fft_res);
+}
+
+QList<QTime> AnalyserCore::downbeats()
+{
+    return framesToTimes(p->beatTracker.downbeats(), p->fft_res);
+}
+
+float AnalyserCore::detectTempo(const FloatSpan *bands)
+{
+    int minBpm=60;
+    int maxBpm=200;
+    qint64 start = AnalysisStats::now();
+
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ ) {
+        p->bandTempo[b].setup(p->fft_res, minBpm, maxBpm);
+        p->bandTempo[b].setThreshold(THRESHOLD_WINDOW_SIZE, MULTIPLIER, p->medianThreshold);
+    }
+
+    // the drum bands run on the thread pool while this thread takes the whole spectrum
+    QList< QFuture<void> > futures;
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        if ( b != SpectralFlux::ALL )
+            futures.append( QtConcurrent::run(&p->bandTempo[b], &BandTempo::analyse, bands[b], (float *)0, (float *)0) );
+
+    // its peaks and correlation stay in the envelope
+    BandTempo &all = p->bandTempo[SpectralFlux::ALL];
+    p->xcorr = p->envelope.xcorr(all.lags(bands[SpectralFlux::ALL].size()));
+    all.analyse(bands[SpectralFlux::ALL], p->envelope.peaksData(), p->xcorr);
+    p->envelope.setPeakCount( all.frames() );
+    p->stats.ns[AnalysisStats::THRESHOLD] = all.thresholdNs();
+    p->stats.ns[AnalysisStats::CORRELATION] = all.correlationNs();
+
+    for ( int i = 0; i < futures.count(); i++ )
+        futures[i].waitForFinished();
+
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        qDebug() << Q_FUNC_INFO << "band"<<b<<"bpm:"<<p->bandTempo[b].bpm()<<"confidence:"<<p->bandTempo[b].confidence();
+
+    int peak = all.lag();
+    if ( peak > 0 ) {
+        qDebug() << Q_FUNC_INFO << "autocorrelation bpm:"<<all.bpm()<< " corr:"<<p->xcorr[peak];
+        qDebug() << Q_FUNC_INFO << "autocorrelation density:"<<all.peakCount()/p->fft_res;
+        qDebug() << Q_FUNC_INFO << "autocorrelation count:"<<all.peakCount();
+    }
+
+    // only the whole spectrum weighted gives the plain result
+    bool fused = false;
+    for ( int b = 0; b < SpectralFlux::BAND_COUNT; b++ )
+        if ( b != SpectralFlux::ALL && p->bandWeights[b] > 0 )
+            fused = true;
+    float bpm;
+    if ( !fused ) {
+        p->confidence = all.confidence();
+        bpm = all.bpm();
+    } else
+        bpm = BandTempo::fuse(p->bandTempo, p->bandWeights, SpectralFlux::BAND_COUNT, &p->confidence);
+
+    // the strongest correlation is often at half or double the tempo a listener taps
+    p->octaveConfidence = 0;
+    if ( p->octaveCorrection && bpm > 0 ) {
+        p->octave.setup(p->fft_res, minBpm, maxBpm);
+        float resolved = p->octave.resolve(p->xcorr, all.lags(bands[SpectralFlux::ALL].size()), bpm);
+        p->octaveConfidence = p->octave.confidence();
+        if ( resolved != bpm )
+            qDebug() << Q_FUNC_INFO << "metrical level:"<<bpm<<"->"<<resolved;
+        bpm = resolved;
+    }
+    p->stats.ns[AnalysisStats::TEMPO] = AnalysisStats::now() - start;
+    return bpm;
+}
+
+void AnalyserCore::setInstrumentation(bool enabled)
+{
+    QMutexLocker locker(&p->mutex);
+    p->instrumented = enabled;
+    p->engine->setStats(enabled ? &p->stats : 0);
+}
+
+AnalysisStats AnalyserCore::stats()
+{
+    return p->stats;
+}
+
+void AnalyserCore::setOctaveCorrection(bool enabled)
+{
+    p->octaveCorrection = enabled;
+}
+
+float AnalyserCore::octaveConfidence()
+{
+    return p->octaveConfidence;
+}
+
+void AnalyserCore::setBandWeight(int band, float weight)
+{
+    if ( band >= 0 && band < SpectralFlux::BAND_COUNT )
+        p->bandWeights[band] = qMax(0.0f, weight);
+}
+
+float AnalyserCore::bandBpm(int band)
+{
+    if ( band < 0 || band >= SpectralFlux::BAND_COUNT )
+        return 0;
+    return p->bandTempo[band].bpm();
+}
+
+float AnalyserCore::bandConfidence(int band)
+{
+    if ( band < 0 || band >= SpectralFlux::BAND_COUNT )
+        return 0;
+    return p->bandTempo[band].confidence();
+}
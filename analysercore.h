@@ -0,0 +1,203 @@
+/*
+    Copyright (C) 2011 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALYSERCORE_H
+#define ANALYSERCORE_H
+
+#include <QtCore>
+
+#define GST_DISABLE_LOADSAVE 1
+#define GST_DISABLE_REGISTRY 1
+#define GST_DISABLE_DEPRECATED 1
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+
+#include "onsetenvelope.h"
+#include "frameengine.h"
+#include "samplering.h"
+#include "analysisstats.h"
+
+class ResultCache;
+
+// Decoding and analysis of a track: tempo, beats, gain and silence. Needs
+// QtCore and GStreamer only, so headless workers link no GUI at all; the
+// results are signalled from the event loop of the thread it lives in.
+class AnalyserCore : public QObject
+{
+    Q_OBJECT
+public:
+    AnalyserCore(QObject *parent = 0);
+    ~AnalyserCore();
+
+    enum modeType { STANDARD, TEMPO };
+
+    bool prepare();
+    void open(QUrl url);
+    void start();
+    bool close();
+    void reset();
+
+    double gainDB();
+    double gainFactor();
+    QTime startPosition();
+    QTime endPosition();
+    int bpm();
+    float confidence();
+    float resolution();
+    FloatSpan peaks();
+    bool finished() {return m_finished;}
+    void setPosition(QTime position);
+
+    // TEMPO decodes only a few windows spread over the track, without gain and silence
+    void setMode(modeType mode);
+    // gain and silence by the rganalysis and cutter elements instead of
+    // the loudness meter on the analysed samples, off by default
+    void setGainElements(bool enabled);
+    // WAV, AIFF and raw PCM from the mapped file instead of the pipeline, on
+    // by default; used only without resampling, so the results stay the same
+    void setPcmFastPath(bool enabled);
+    // format of headerless .raw and .pcm files, type is a PcmFile::sampleType
+    void setRawFormat(int rate, int channels, int type, bool bigEndian = false);
+
+    // decoded audio instead of a file: interleaved floats of one or two
+    // channels at any rate. The same results as a file of these samples,
+    // but no cache, as there is no file name to look them up by.
+    // analyse() returns with all results and signals emitted,
+    // analyseAsync() needs the data until finishTempo.
+    bool analyse(const float *data, qint64 frames, int rate, int channels);
+    bool analyseAsync(const float *data, qint64 frames, int rate, int channels);
+    // the same chunk by chunk, each one is analysed before pushSamples returns
+    // unless pipelined; a stream of unknown length is never sampled by a scan
+    bool beginStream(int rate, int channels);
+    void pushSamples(const float *data, int frames);
+    void endStream();
+
+    // tracks of at least minSeconds are decoded as that many parts in parallel,
+    // each in a pipeline of its own; 0 chunks is one per core, 1 turns it off
+    void setChunking(int chunks, int minSeconds = 600);
+    // sample rate of the onset detection, 0 analyses at the native rate
+    void setAnalysisRate(int rate, bool mono = false);
+    // fft size, hop and window of the onset detection
+    void setPreset(FrameEngine::presetType preset);
+    void setScanWindows(int windows, int seconds);
+
+    // provisional tempo while decoding, reported every intervalMs of audio
+    void setOnline(bool online, int intervalMs = 1000);
+    // stop decoding once the estimate held for stableSecs, 0 disables
+    void setEarlyStop(int stableSecs, float minConfidence = 0.3f);
+    // sliding median instead of the running mean as onset threshold
+    void setMedianThreshold(bool median);
+    // decode in the streaming thread and run the dsp in a thread of its own
+    void setPipelined(bool pipelined);
+    SampleRing::Stats ringStats();
+    // results of known files are taken from the cache instead of decoding them, not owned
+    void setCache(ResultCache *cache);
+    bool cached();
+    // onset envelopes of each finished track go to fileName, see EnvelopeFile::flagType
+    void setEnvelopeFile(const QString &fileName, int flags = 0);
+    // tempo from a stored envelope instead of decoding, the gain stays invalid
+    bool openEnvelope(const QString &fileName);
+
+    // share of each SpectralFlux band in the tempo decision, only ALL counts by default
+    void setBandWeight(int band, float weight);
+    // tempo and confidence every band found on its own
+    float bandBpm(int band);
+    float bandConfidence(int band);
+
+    // half or double tempo by a comb filter bank, on by default
+    void setOctaveCorrection(bool enabled);
+    // how clearly the chosen tempo beat its half and double, 0..1
+    float octaveConfidence();
+
+    // per frame timings of downmix, fft and flux; the other stages are always timed
+    void setInstrumentation(bool enabled);
+    // where the time of the last track went, complete when finishTempo is emitted
+    AnalysisStats stats();
+
+    // beat grid of the last track, the first beat of each bar in downbeats
+    QList<QTime> beats();
+    QList<QTime> downbeats();
+
+    QTime length();
+    static const int GAIN_INVALID=-99;
+
+    void need_finish();
+    void newpad (GstElement *decodebin, GstPad *pad, gpointer data);
+    static GstFlowReturn cb_new_sample (GstAppSink *appsink, gpointer data);
+    static GstBusSyncReply  bus_cb (GstBus *bus, GstMessage *msg, gpointer data);
+
+ Q_SIGNALS:
+        void finishGain();
+        void finishTempo();
+        void tempoEstimate(int bpm, float confidence);
+
+ private slots:
+    void messageReceived(GstMessage* message);
+    void dataReceived(GstSample *sample);
+    void loadThreadFinished();
+    void stopEarly(int track);
+    void nextScanWindow(int track);
+    void finishStored(int track);
+    void chunkFinished();
+
+ private:
+    friend class AnalysisThread;
+    struct AnalyserCore_Private *p;
+        GstElement *pipeline;
+        GstBus *bus;
+
+        double m_GainDB;
+        QTime m_StartPosition;
+        QTime m_EndPosition;
+        QTime m_MaxPosition;
+        bool m_finished;
+
+        float detectTempo(const FloatSpan *bands);
+        void linkAudioBin();
+        void trackBeats(const FloatSpan *bands, float bpm);
+
+        void cleanup();
+        void resetTrack();
+        void samplesReceived(const float *data, int frames);
+        void consumeSamples();
+        void resetRing(int channels);
+        void onlineUpdate(float flux);
+        void seekScanWindow(int index);
+        void stitchScanWindow();
+        void updateSinkCaps();
+        void configureRate(int rate);
+        int negotiatedRate();
+        void asyncOpen(QUrl url);
+        bool openCached(QUrl url);
+        bool openPcm(QUrl url);
+        bool openMemory(const float *data, qint64 frames, int rate, int channels);
+        void prepareSamples(int rate, qint64 frames, int sourceChannels);
+        int sourceChannels();
+        void analyseSource();
+        void readSource(qint64 first, qint64 count);
+        void feedSamples(const float *data, int channels, qint64 count);
+        void deliverSamples(const float *data, int frames);
+        void stopSource();
+        int planScanWindows(int seconds);
+        bool startChunks(int seconds);
+        void stopChunks();
+        void seekRange();
+        void mergeChunks();
+        QByteArray cacheParameters();
+        void sync_set_state(GstElement*, GstState);
+   };
+
+#endif // ANALYSERCORE_H
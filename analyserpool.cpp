@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "analyserpool.h"
+#include "analysercore.h"
+
+AnalyserPool::AnalyserPool(int size, QObject *parent) :
+        QObject(parent)
+{
+    // pipelines are built here once, not per track
+    for (int i = 0; i < qMax(1, size); i++) {
+        AnalyserCore *analyser = new AnalyserCore();
+        analyser->setObjectName(QString("analyser%1").arg(i));
+        m_all.append(analyser);
+        m_free.append(analyser);
+    }
+}
+
+AnalyserPool::~AnalyserPool()
+{
+    qDeleteAll(m_all);
+}
+
+AnalyserCore* AnalyserPool::acquire(int timeout)
+{
+    QMutexLocker locker(&m_mutex);
+    QElapsedTimer clock;
+    clock.start();
+
+    while (m_free.isEmpty()) {
+        if (timeout == 0)
+            return 0;
+        unsigned long wait = timeout < 0 ? ULONG_MAX : qMax<qint64>(0, timeout - clock.elapsed());
+        if (!m_released.wait(&m_mutex, wait) && m_free.isEmpty())
+            return 0;
+    }
+    return m_free.takeFirst();
+}
+
+void AnalyserPool::release(AnalyserCore *analyser)
+{
+    if (!analyser || !m_all.contains(analyser))
+        return;
+
+    // drop the stream and all results of the last track before anyone else gets it
+    analyser->reset();
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_free.contains(analyser)) {
+        m_free.append(analyser);
+        m_released.wakeOne();
+    }
+}
+
+int AnalyserPool::available()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_free.count();
+}
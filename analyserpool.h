@@ -0,0 +1,47 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALYSERPOOL_H
+#define ANALYSERPOOL_H
+
+#include <QtCore>
+
+class AnalyserCore;
+
+// Keeps a number of prepared analysers with their pipelines in READY state.
+// Worker threads take one for a track and give it back once the result is read.
+class AnalyserPool : public QObject
+{
+    Q_OBJECT
+public:
+    AnalyserPool(int size, QObject *parent = 0);
+    ~AnalyserPool();
+
+    AnalyserCore* acquire(int timeout = -1);
+    AnalyserCore* tryAcquire() {return acquire(0);}
+    void release(AnalyserCore *analyser);
+
+    int size() {return m_all.count();}
+    int available();
+
+ private:
+    QMutex m_mutex;
+    QWaitCondition m_released;
+    QList<AnalyserCore*> m_all;
+    QList<AnalyserCore*> m_free;
+};
+
+#endif // ANALYSERPOOL_H
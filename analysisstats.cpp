@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "analysisstats.h"
+
+#include <string.h>
+
+void AnalysisStats::clear()
+{
+    memset(ns, 0, sizeof(ns));
+    buffers = 0;
+    bytes = 0;
+    frames = 0;
+    allocations = 0;
+}
+
+const char* AnalysisStats::stageName(int stage)
+{
+    static const char *names[STAGE_COUNT] = {
+        "open", "decode", "downmix", "fft", "flux", "loudness", "threshold", "correlation", "tempo", "beats"
+    };
+    return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "";
+}
+
+QJsonObject AnalysisStats::toJson() const
+{
+    QJsonObject stages;
+    for (int s = 0; s < STAGE_COUNT; s++)
+        stages[stageName(s)] = ns[s] / 1000; // microseconds are plenty
+
+    QJsonObject json;
+    json["stages_us"] = stages;
+    json["buffers"] = buffers;
+    json["bytes"] = bytes;
+    json["frames"] = frames;
+    json["allocations"] = allocations;
+    return json;
+}
@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALYSISSTATS_H
+#define ANALYSISSTATS_H
+
+#include <QtCore>
+#include <chrono>
+
+// Where the time of one analysis went. Stages are wall time on the
+// monotonic clock in nanoseconds; the per frame stages are only measured
+// while instrumentation is on, otherwise the hot path pays one branch.
+struct AnalysisStats
+{
+    enum stageType {
+        OPEN,           // from open() until the track is prerolled
+        DECODE,         // streaming time not spent in the per frame stages
+        DOWNMIX,
+        FFT,            // window and transform
+        FLUX,
+        LOUDNESS,       // gain and silence of the samples
+        THRESHOLD,      // peak picking of the whole spectrum band
+        CORRELATION,    // its autocorrelation
+        TEMPO,          // all bands, fusion and octave check
+        BEATS,
+        STAGE_COUNT
+    };
+
+    qint64 ns[STAGE_COUNT];
+    qint64 buffers;     // decoded buffers which reached the analysis
+    qint64 bytes;       // their size
+    qint64 frames;      // frames of the frame engine
+    qint64 allocations; // scratch and envelope growth on the way
+
+    AnalysisStats() {clear();}
+    void clear();
+
+    QJsonObject toJson() const;
+    static const char* stageName(int stage);
+
+    static inline qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+#endif // ANALYSISSTATS_H
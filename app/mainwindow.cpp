@@ -69,25 +69,29 @@ MainWindow::~MainWindow()
 
 void MainWindow::analyseTempoFinished()
 {
+    FloatSpan peaks = trackanalyser->peaks();
     qDebug() << " resolution:" <<trackanalyser->resolution();
-    qDebug() << " onset count:" <<trackanalyser->peaks().count();
+    qDebug() << " onset count:" <<peaks.count();
 
     // Show BPM Result
     ui->lblBpm->setText(QString::number(trackanalyser->bpm()));
-    int interval = 60 * trackanalyser->resolution() / trackanalyser->bpm();
 
     // Draw found onsets
     scene->clear();
     QPen onsetPen(Qt::blue);
     QPen tempoPen(Qt::green);
-    int j=0;
-    for ( int i=0;i<trackanalyser->peaks().count();i++,j++ ) {
-
-        scene->addLine( QLineF( i, h, i, h-trackanalyser->peaks().at(i)*2 ), onsetPen);
-        if ( j==interval ){
-            scene->addLine( QLineF( i, h, i, h + h*.2 ), tempoPen);
-            j=0;
-        }
+    QPen barPen(Qt::darkGreen);
+    for ( int i=0;i<peaks.count();i++ )
+        scene->addLine( QLineF( i, h, i, h-peaks.at(i)*2 ), onsetPen);
+
+    // Draw the beat grid, bars reach further down
+    foreach ( const QTime &beat, trackanalyser->beats() ) {
+        int i = QTime(0,0).msecsTo(beat) * trackanalyser->resolution() / 1000;
+        scene->addLine( QLineF( i, h, i, h + h*.2 ), tempoPen);
+    }
+    foreach ( const QTime &downbeat, trackanalyser->downbeats() ) {
+        int i = QTime(0,0).msecsTo(downbeat) * trackanalyser->resolution() / 1000;
+        scene->addLine( QLineF( i, h, i, h + h*.3 ), barPen);
     }
 
 }
@@ -0,0 +1,28 @@
+/*
+    Copyright (C) 2011 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trackanalyser.h"
+
+TrackAnalyser::TrackAnalyser(QWidget *parent) :
+        QWidget(parent)
+{
+    // the core goes with the widget, its signals are the widget's
+    m_core = new AnalyserCore(this);
+    connect(m_core, SIGNAL(finishGain()), this, SIGNAL(finishGain()));
+    connect(m_core, SIGNAL(finishTempo()), this, SIGNAL(finishTempo()));
+    connect(m_core, SIGNAL(tempoEstimate(int,float)), this, SIGNAL(tempoEstimate(int,float)));
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright (C) 2011 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRACKANALYSER_H
+#define TRACKANALYSER_H
+
+#include <QWidget>
+
+#include "analysercore.h"
+
+// The analyser as a widget for the GUI, a thin adapter on AnalyserCore.
+// Everything beyond the results the window shows is on core().
+class TrackAnalyser : public QWidget
+{
+    Q_OBJECT
+public:
+    TrackAnalyser(QWidget *parent = 0);
+
+    AnalyserCore* core() {return m_core;}
+
+    void open(QUrl url) {m_core->open(url);}
+    void start() {m_core->start();}
+    bool close() {return m_core->close();}
+    void reset() {m_core->reset();}
+    void setPosition(QTime position) {m_core->setPosition(position);}
+    void setMode(AnalyserCore::modeType mode) {m_core->setMode(mode);}
+
+    double gainDB() {return m_core->gainDB();}
+    double gainFactor() {return m_core->gainFactor();}
+    QTime startPosition() {return m_core->startPosition();}
+    QTime endPosition() {return m_core->endPosition();}
+    QTime length() {return m_core->length();}
+    int bpm() {return m_core->bpm();}
+    float confidence() {return m_core->confidence();}
+    float resolution() {return m_core->resolution();}
+    FloatSpan peaks() {return m_core->peaks();}
+    bool finished() {return m_core->finished();}
+    QList<QTime> beats() {return m_core->beats();}
+    QList<QTime> downbeats() {return m_core->downbeats();}
+
+ Q_SIGNALS:
+        void finishGain();
+        void finishTempo();
+        void tempoEstimate(int bpm, float confidence);
+
+ private:
+        AnalyserCore *m_core;
+};
+
+#endif // TRACKANALYSER_H
@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "autocorrelation.h"
+
+#include <QtCore>
+#include <string.h>
+
+AutoCorrelator::AutoCorrelator() :
+    m_size(0), m_fft(0), m_ifft(0), m_timedata(0), m_freqdata(0)
+{
+}
+
+AutoCorrelator::~AutoCorrelator()
+{
+    resize(0);
+}
+
+void AutoCorrelator::resize(int size)
+{
+    if (size == m_size)
+        return;
+
+    if (m_fft) gst_fft_f64_free (m_fft);
+    if (m_ifft) gst_fft_f64_free (m_ifft);
+    g_free (m_timedata);
+    g_free (m_freqdata);
+    m_fft = m_ifft = 0;
+    m_timedata = 0;
+    m_freqdata = 0;
+    m_size = size;
+
+    if (size > 0) {
+        m_fft = gst_fft_f64_new (size, FALSE);
+        m_ifft = gst_fft_f64_new (size, TRUE);
+        m_timedata = g_new (gdouble, size);
+        m_freqdata = g_new (GstFFTF64Complex, size / 2 + 1);
+    }
+}
+
+bool AutoCorrelator::preferFFT(int frames, int minLag, int maxLag)
+{
+    if (frames <= 0 || maxLag <= minLag)
+        return false;
+
+    // forward and inverse real fft of the padded envelope against one sum per lag
+    qint64 size = 2 * (qint64)frames;
+    qint64 fftCost = 3 * size * qMax(1, (int)ceil(log2((double)size)));
+    qint64 directCost = (qint64)frames * (maxLag - minLag);
+    return directCost > fftCost;
+}
+
+void AutoCorrelator::compute(const float *data, int frames, float *xcorr, int lags)
+{
+    if (lags <= 0)
+        return;
+    memset(xcorr, 0, lags * sizeof(float));
+    if (frames <= 0)
+        return;
+
+    // padding to at least 2*frames keeps the circular correlation free of wrap around
+    int size = gst_fft_next_fast_length (2 * frames);
+    while (size % 2)
+        size = gst_fft_next_fast_length (size + 1);
+    resize(size);
+
+    for (int i = 0; i < frames; i++)
+        m_timedata[i] = data[i];
+    memset(m_timedata + frames, 0, (size - frames) * sizeof(gdouble));
+
+    gst_fft_f64_fft (m_fft, m_timedata, m_freqdata);
+
+    // power spectrum, its inverse transform is the autocorrelation
+    for (int i = 0; i <= size / 2; i++) {
+        m_freqdata[i].r = m_freqdata[i].r * m_freqdata[i].r + m_freqdata[i].i * m_freqdata[i].i;
+        m_freqdata[i].i = 0;
+    }
+
+    gst_fft_f64_inverse_fft (m_ifft, m_freqdata, m_timedata);
+
+    // the inverse transform is not normalized
+    int n = qMin(lags, frames);
+    for (int lag = 0; lag < n; lag++)
+        xcorr[lag] = m_timedata[lag] / size;
+}
@@ -0,0 +1,50 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef AUTOCORRELATION_H
+#define AUTOCORRELATION_H
+
+#include <QtGlobal>
+#include <gst/fft/gstfftf64.h>
+
+// Autocorrelation of an onset envelope for all lags in one pass (Wiener-Khinchin):
+// the power spectrum of the zero padded envelope transformed back gives
+// xcorr[lag] = sum of data[i] * data[i+lag], the same values as the direct sum.
+class AutoCorrelator
+{
+public:
+    AutoCorrelator();
+    ~AutoCorrelator();
+
+    // fills xcorr[0 .. lags-1], lags beyond the envelope become 0
+    void compute(const float *data, int frames, float *xcorr, int lags);
+
+    // true if the fft is cheaper than summing frames x (maxLag-minLag) products
+    static bool preferFFT(int frames, int minLag, int maxLag);
+
+private:
+    Q_DISABLE_COPY(AutoCorrelator)
+
+    int m_size;
+    GstFFTF64 *m_fft;
+    GstFFTF64 *m_ifft;
+    gdouble *m_timedata;
+    GstFFTF64Complex *m_freqdata;
+
+    void resize(int size);
+};
+
+#endif // AUTOCORRELATION_H
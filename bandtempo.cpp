@@ -0,0 +1,165 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bandtempo.h"
+#include "onsetthreshold.h"
+#include "autocorrelation.h"
+#include "analysisstats.h"
+
+#include <QDebug>
+#include <string.h>
+
+BandTempo::BandTempo() :
+    m_frameRate(0), m_minLag(0), m_maxLag(0),
+    m_window(10), m_multiplier(2.0f), m_median(false),
+    m_xcorr(0), m_lastLag(0), m_frames(0), m_peakCount(0), m_lag(0), m_bpm(0), m_confidence(0),
+    m_thresholdNs(0), m_correlationNs(0)
+{
+}
+
+void BandTempo::setup(float frameRate, int minBpm, int maxBpm)
+{
+    m_frameRate = frameRate;
+    m_maxLag = frameRate * 60 / minBpm;
+    m_minLag = frameRate * 60 / maxBpm;
+}
+
+void BandTempo::setThreshold(int window, float multiplier, bool median)
+{
+    m_window = window;
+    m_multiplier = multiplier;
+    m_median = median;
+}
+
+int BandTempo::lags(int frames) const
+{
+    // short or broken files give less frames than lags
+    return qMax(frames, HARMONICS * m_maxLag + 1);
+}
+
+void BandTempo::analyse(FloatSpan onsets, float *peaks, float *xcorr)
+{
+    m_lag = 0;
+    m_bpm = 0;
+    m_confidence = 0;
+
+    qint64 start = AnalysisStats::now();
+
+    //running average threshold, only the signifikat onsets above it count as peaks
+    if ( !peaks ) {
+        m_peakData.resize(qMax(1, onsets.size()));
+        peaks = m_peakData.data();
+    }
+    OnsetThreshold threshold(m_window, m_multiplier, m_median);
+    m_frames = threshold.process(onsets.data(), onsets.size(), peaks);
+    m_peakCount = threshold.peakCount();
+    qint64 thresholded = AnalysisStats::now();
+    m_thresholdNs = thresholded - start;
+
+    int size = lags(m_frames);
+    if ( !xcorr ) {
+        m_xcorrData.resize(size);
+        xcorr = m_xcorrData.data();
+    }
+    m_xcorr = xcorr;
+
+    //use autocorrelation to retrieve time periode of peaks, the harmonics tell the metrical level,
+    //the octave pulses reach one lag below the shortest
+    m_lastLag = qMin(size - 1, HARMONICS * m_maxLag);
+    correlate(peaks, m_frames, xcorr, size, qMax(0, m_minLag - 1), m_lastLag, AUTO, &m_correlator);
+    m_correlationNs = AnalysisStats::now() - thresholded;
+
+    m_lag = bestLag(xcorr, m_minLag, m_maxLag, &m_confidence);
+    if ( m_lag > 0 )
+        m_bpm = 60.0 * m_frameRate / m_lag;
+}
+
+void BandTempo::correlate(const float *peaks, int frames, float *xcorr, int size,
+                          int minLag, int lastLag, methodType method,
+                          AutoCorrelator *correlator)
+{
+    if ( method == AUTO )
+        method = AutoCorrelator::preferFFT(frames, minLag, lastLag + 1) ? FFT : DIRECT;
+
+    if ( method == FFT ) {
+        // all lags at once, only the range of the direct sums is kept
+        AutoCorrelator local;
+        (correlator ? correlator : &local)->compute(peaks, frames, xcorr, size);
+        memset(xcorr, 0, qMin(minLag, size) * sizeof(float));
+        if ( lastLag + 1 < size )
+            memset(xcorr + lastLag + 1, 0, (size - lastLag - 1) * sizeof(float));
+        return;
+    }
+
+    memset(xcorr, 0, size * sizeof(float));
+    for (int lag = minLag; lag <= lastLag; lag++) {
+        float sum = 0;
+        for (int i = 0; i < frames - lag; i++)
+            sum += peaks[i + lag] * peaks[i];
+        xcorr[lag] = sum;
+    }
+}
+
+int BandTempo::bestLag(const float *xcorr, int minLag, int maxLag, float *confidence)
+{
+    float maxCorr = 0;
+    double sum = 0;
+    int optiLag = 0;
+    for (int lag = minLag; lag < maxLag; lag++) {
+        sum += xcorr[lag];
+        if ( xcorr[lag] > maxCorr ) {
+            maxCorr = xcorr[lag];
+            optiLag = lag;
+        }
+    }
+
+    *confidence = 0;
+    if ( optiLag > 0 && maxLag > minLag )
+        *confidence = (maxCorr - sum / (maxLag - minLag)) / maxCorr;
+    return optiLag;
+}
+
+float BandTempo::fuse(const BandTempo *bands, const float *weights, int count, float *confidence)
+{
+    *confidence = 0;
+    if ( count == 0 )
+        return 0;
+
+    int minLag = bands[0].m_minLag;
+    int maxLag = bands[0].m_maxLag;
+    QVector<float> fused(maxLag + 1, 0.0f);
+    float total = 0;
+    for (int b = 0; b < count; b++) {
+        const BandTempo &band = bands[b];
+        if ( weights[b] <= 0 || !band.m_xcorr || band.m_lag == 0 )
+            continue;
+        // bands of little energy count as much as loud ones
+        float scale = weights[b] / band.m_xcorr[band.m_lag];
+        for (int lag = minLag; lag < maxLag; lag++)
+            fused[lag] += band.m_xcorr[lag] * scale;
+        total += weights[b];
+    }
+    if ( total == 0 )
+        return 0;
+
+    int lag = bestLag(fused.constData(), minLag, maxLag, confidence);
+    if ( lag == 0 )
+        return 0;
+
+    qDebug() << Q_FUNC_INFO << "fused lag:" << lag << "confidence:" << *confidence;
+    return 60.0 * bands[0].m_frameRate / lag;
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BANDTEMPO_H
+#define BANDTEMPO_H
+
+#include <QVector>
+
+#include "onsetenvelope.h"
+#include "autocorrelation.h"
+
+// Tempo of a single onset envelope: threshold and peak picking, then the
+// autocorrelation of the peaks over the lags of the tempo range. Several
+// bands of a track can be analysed at the same time, each one with its own
+// instance, and their correlations fused into one decision.
+class BandTempo
+{
+public:
+    // the correlation reaches this many periods of the slowest tempo
+    enum { HARMONICS = 4 };
+    enum methodType { AUTO, DIRECT, FFT };
+
+    BandTempo();
+
+    void setup(float frameRate, int minBpm = 60, int maxBpm = 200);
+    void setThreshold(int window, float multiplier, bool median);
+
+    // room the correlation of an envelope of frames values needs, harmonics included
+    int lags(int frames) const;
+    // lags up to here hold the correlation, beyond it they are 0
+    int lastLag() const {return m_lastLag;}
+    // peaks needs frames values and xcorr lags(frames), both are kept here when not given
+    void analyse(FloatSpan onsets, float *peaks = 0, float *xcorr = 0);
+
+    float bpm() const {return m_bpm;}
+    float confidence() const {return m_confidence;}
+    int lag() const {return m_lag;}
+    int frames() const {return m_frames;}
+    int peakCount() const {return m_peakCount;}
+    int minLag() const {return m_minLag;}
+    int maxLag() const {return m_maxLag;}
+    const float* xcorr() const {return m_xcorr;}
+    // monotonic time of the last analyse()
+    qint64 thresholdNs() const {return m_thresholdNs;}
+    qint64 correlationNs() const {return m_correlationNs;}
+
+    // xcorr[minLag .. lastLag] of the peaks and 0 elsewhere, AUTO takes the cheaper way,
+    // the FFT plans of correlator are kept for the next call of the same size
+    static void correlate(const float *peaks, int frames, float *xcorr, int size,
+                          int minLag, int lastLag, methodType method = AUTO,
+                          AutoCorrelator *correlator = 0);
+    // best lag of the weighted sum of the correlations, each one scaled to its maximum
+    static float fuse(const BandTempo *bands, const float *weights, int count, float *confidence);
+    // best lag in [minLag, maxLag) and how far it stands out of the mean, 0..1
+    static int bestLag(const float *xcorr, int minLag, int maxLag, float *confidence);
+
+private:
+    float m_frameRate;
+    int m_minLag;
+    int m_maxLag;
+    int m_window;
+    float m_multiplier;
+    bool m_median;
+
+    QVector<float> m_peakData;
+    QVector<float> m_xcorrData;
+    AutoCorrelator m_correlator;
+    const float *m_xcorr;
+    int m_lastLag;
+
+    int m_frames;
+    int m_peakCount;
+    int m_lag;
+    float m_bpm;
+    float m_confidence;
+    qint64 m_thresholdNs;
+    qint64 m_correlationNs;
+};
+
+#endif // BANDTEMPO_H
@@ -0,0 +1,108 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "beattracker.h"
+
+#include <algorithm>
+#include <math.h>
+
+// beats of a bar in the downbeat search
+#define BEATS_PER_BAR 4
+
+BeatTracker::BeatTracker() :
+    m_tightness(100.0f), m_phase(0)
+{
+}
+
+void BeatTracker::clear()
+{
+    m_phase = 0;
+    m_beats.clear();
+    m_downbeats.clear();
+}
+
+void BeatTracker::track(FloatSpan onsets, float frameRate, float bpm, FloatSpan accents)
+{
+    clear();
+    int frames = onsets.size();
+    if ( bpm <= 0 || frameRate <= 0 || frames == 0 )
+        return;
+
+    float period = 60.0f * frameRate / bpm;
+    int minStep = qMax(1, qRound(period - period / 8));
+    int maxStep = qMax(minStep, qRound(period + period / 8));
+
+    // onsets in units of their deviation, so the tightness means the same for every track
+    double sum = 0, squares = 0;
+    for ( int i = 0; i < frames; i++ ) {
+        sum += onsets[i];
+        squares += (double)onsets[i] * onsets[i];
+    }
+    double variance = squares / frames - (sum / frames) * (sum / frames);
+    float norm = variance > 0 ? 1.0 / sqrt(variance) : 1.0f;
+
+    QVector<float> penalty(maxStep + 1);
+    for ( int step = minStep; step <= maxStep; step++ ) {
+        float deviation = log(step / period);
+        penalty[step] = m_tightness * deviation * deviation;
+    }
+
+    m_score.resize(frames);
+    m_from.resize(frames);
+    float *score = m_score.data();
+    int *from = m_from.data();
+    for ( int t = 0; t < frames; t++ ) {
+        float best = 0;
+        int previous = -1;
+        for ( int step = minStep; step <= maxStep && step <= t; step++ ) {
+            float candidate = score[t - step] - penalty[step];
+            if ( candidate > best ) {
+                best = candidate;
+                previous = t - step;
+            }
+        }
+        // a chain only pays off while it scores above starting afresh
+        score[t] = onsets[t] * norm + best;
+        from[t] = previous;
+    }
+
+    int last = frames - 1;
+    for ( int t = qMax(0, frames - maxStep); t < frames; t++ )
+        if ( score[t] > score[last] )
+            last = t;
+
+    for ( int t = last; t >= 0; t = from[t] )
+        m_beats.append(t);
+    std::reverse(m_beats.begin(), m_beats.end());
+
+    // the phase whose beats carry the most accent starts the bars
+    FloatSpan accent = accents.size() == frames ? accents : onsets;
+    double phases[BEATS_PER_BAR] = {0, 0, 0, 0};
+    int counts[BEATS_PER_BAR] = {0, 0, 0, 0};
+    for ( int i = 0; i < m_beats.count(); i++ ) {
+        phases[i % BEATS_PER_BAR] += accent[m_beats.at(i)];
+        counts[i % BEATS_PER_BAR]++;
+    }
+    for ( int k = 0; k < BEATS_PER_BAR; k++ )
+        if ( counts[k] > 0 )
+            phases[k] /= counts[k];
+    for ( int k = 1; k < BEATS_PER_BAR; k++ )
+        if ( phases[k] > phases[m_phase] )
+            m_phase = k;
+    for ( int i = m_phase; i < m_beats.count(); i += BEATS_PER_BAR )
+        m_downbeats.append(m_beats.at(i));
+}
@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BEATTRACKER_H
+#define BEATTRACKER_H
+
+#include <QVector>
+
+#include "onsetenvelope.h"
+
+// Beat positions of an onset envelope by dynamic programming: the score of
+// a frame is its onset strength plus the best score of a frame about one
+// beat period earlier, less a penalty for straying from the tempo. Only
+// predecessors within an eighth of the period are tried, so time and
+// memory are linear in the frames. Backtracking from the best frame of the
+// last period gives the beats. The downbeat is the beat phase of a 4/4 bar
+// with the strongest accents.
+class BeatTracker
+{
+public:
+    BeatTracker();
+
+    // how strictly beats keep the tempo, larger values give a more even grid
+    void setTightness(float tightness) {m_tightness = tightness;}
+
+    // accents weight the downbeat phases, the onsets themselves when empty
+    void track(FloatSpan onsets, float frameRate, float bpm, FloatSpan accents = FloatSpan());
+    void clear();
+
+    // frame indexes into the envelope
+    const QVector<int>& beats() const {return m_beats;}
+    const QVector<int>& downbeats() const {return m_downbeats;}
+    // which beat of the first four starts a bar
+    int downbeatPhase() const {return m_phase;}
+
+private:
+    float m_tightness;
+    int m_phase;
+    QVector<float> m_score;
+    QVector<int> m_from;
+    QVector<int> m_beats;
+    QVector<int> m_downbeats;
+};
+
+#endif // BEATTRACKER_H
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Microbenchmark of the analysis hot paths on synthetic
+# buffers in memory, no pipeline and no GUI involved
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = beatanalysis-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp
+
+include(../core.pri)
@@ -0,0 +1,290 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <math.h>
+#include <stdlib.h>
+#include <new>
+
+#include "frameengine.h"
+#include "spectralflux.h"
+#include "onsetenvelope.h"
+#include "onsetthreshold.h"
+#include "bandtempo.h"
+#include "octaveresolver.h"
+#include "beattracker.h"
+#include "loudnessmeter.h"
+
+#define RATE 44100
+#define CHANNELS 2
+// the synthetic source is looped, long runs do not need gigabytes of samples
+#define SOURCE_SECONDS 10
+#define SOURCE_BPM 128
+
+// every operator new of the process, glib and malloc allocations are not seen
+static QAtomicInt allocations;
+
+void *operator new(size_t size)
+{
+    allocations.ref();
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+struct Result
+{
+    QString stage;
+    int seconds;
+    qint64 frames;
+    int iterations;
+    qint64 nsecs;
+    int allocs;
+};
+
+static QString presetName;
+static bool json = false;
+static qint64 minTime = 500;
+static int maxIterations = 1000;
+
+// runs body until minTime passed, at least once
+template <typename Body>
+static Result measure(const QString &stage, int seconds, qint64 frames, Body body)
+{
+    Result result;
+    result.stage = stage;
+    result.seconds = seconds;
+    result.frames = frames;
+    result.iterations = 0;
+
+    int before = allocations.load();
+    QElapsedTimer clock;
+    clock.start();
+    do {
+        body();
+        result.iterations++;
+    } while (clock.elapsed() < minTime && result.iterations < maxIterations);
+    result.nsecs = clock.nsecsElapsed();
+    result.allocs = allocations.load() - before;
+    return result;
+}
+
+static void report(const Result &result)
+{
+    qint64 frames = result.frames * result.iterations;
+    double nsPerFrame = frames ? (double)result.nsecs / frames : 0;
+    double framesPerSec = result.nsecs ? frames * 1e9 / result.nsecs : 0;
+    double allocsPerFrame = frames ? (double)result.allocs / frames : 0;
+
+    QTextStream out(stdout);
+    if (json) {
+        QJsonObject line;
+        line["stage"] = result.stage;
+        line["preset"] = presetName;
+        line["seconds"] = result.seconds;
+        line["frames"] = result.frames;
+        line["iterations"] = result.iterations;
+        line["ns_per_frame"] = nsPerFrame;
+        line["frames_per_s"] = framesPerSec;
+        line["allocs_per_frame"] = allocsPerFrame;
+        out << QJsonDocument(line).toJson(QJsonDocument::Compact) << "\n";
+    }
+    else {
+        out << QString("%1 %2 s %3 frames %4 ns/frame %5 frames/s %6 allocs/frame\n")
+               .arg(result.stage, -12)
+               .arg(result.seconds, 6)
+               .arg(result.frames, 9)
+               .arg(nsPerFrame, 10, 'f', 1)
+               .arg(framesPerSec, 12, 'f', 0)
+               .arg(allocsPerFrame, 8, 'f', 4);
+    }
+    out.flush();
+}
+
+// interleaved stereo: a kick on every beat, hi-hat noise on the off beats and a quiet floor
+static QVector<float> synthesize(int window)
+{
+    int frames = SOURCE_SECONDS * RATE;
+    QVector<float> source((frames + window) * CHANNELS);
+    int beat = 60 * RATE / SOURCE_BPM;
+    srand(1);
+    for (int i = 0; i < frames; i++) {
+        int inBeat = i % beat;
+        int offBeat = (i + beat / 2) % beat;
+        float kick = inBeat < RATE / 10 ? sinf(2 * M_PI * 60 * inBeat / RATE) * expf(-inBeat * 40.0f / RATE) : 0;
+        float noise = (rand() / (float)RAND_MAX - 0.5f);
+        float hat = offBeat < RATE / 50 ? noise * expf(-offBeat * 200.0f / RATE) * 0.5f : 0;
+        float sample = 0.8f * kick + hat + 0.01f * noise;
+        source[i * CHANNELS] = sample;
+        source[i * CHANNELS + 1] = sample;
+    }
+    // the first window again, so every frame is contiguous
+    for (int i = 0; i < window * CHANNELS; i++)
+        source[frames * CHANNELS + i] = source[i];
+    return source;
+}
+
+static void run(FrameEngine::presetType preset, int seconds)
+{
+    FrameEngine *engine = FrameEngine::create(preset);
+    engine->configure(RATE);
+    int fftSize = engine->fftSize();
+    int hop = engine->hop();
+    int window = qMax(hop, fftSize);
+    float frameRate = engine->frameRate();
+    qint64 frames = (qint64)seconds * RATE / hop;
+
+    QVector<float> source = synthesize(window);
+    int sourceFrames = SOURCE_SECONDS * RATE;
+    QVector<float> mono(window);
+    OnsetEnvelope envelope;
+    envelope.reserve(frames);
+
+    // what the appsink callback does per frame
+    report(measure("frames", seconds, frames, [&]() {
+        envelope.clear();
+        engine->reset();
+        qint64 position = 0;
+        for (qint64 f = 0; f < frames; f++) {
+            SpectralFlux::downmix(source.constData() + position * CHANNELS, CHANNELS, fftSize, mono.data());
+            float flux[SpectralFlux::BAND_COUNT];
+            engine->process(mono.constData(), flux);
+            envelope.append(flux);
+            position = (position + hop) % sourceFrames;
+        }
+    }));
+
+    // gain and silence over the same samples, one hop per frame
+    LoudnessMeter loudness;
+    loudness.setup(RATE, CHANNELS);
+    report(measure("loudness", seconds, frames, [&]() {
+        loudness.clear();
+        qint64 position = 0;
+        for (qint64 f = 0; f < frames; f++) {
+            loudness.process(source.constData() + position * CHANNELS, hop);
+            position = (position + hop) % sourceFrames;
+        }
+    }));
+
+    FloatSpan onsets = envelope.band(SpectralFlux::ALL);
+    QVector<float> peaks(onsets.size());
+    report(measure("threshold", seconds, frames, [&]() {
+        OnsetThreshold threshold(10, 2.0f, false);
+        threshold.process(onsets.data(), onsets.size(), peaks.data());
+    }));
+
+    BandTempo tempo;
+    tempo.setup(frameRate);
+    int size = tempo.lags(onsets.size());
+    int lastLag = qMin(size - 1, BandTempo::HARMONICS * tempo.maxLag());
+    QVector<float> xcorr(size);
+    AutoCorrelator correlator;
+    report(measure("acf-direct", seconds, frames, [&]() {
+        BandTempo::correlate(peaks.constData(), onsets.size() - 1, xcorr.data(), size,
+                             tempo.minLag(), lastLag, BandTempo::DIRECT);
+    }));
+    report(measure("acf-fft", seconds, frames, [&]() {
+        BandTempo::correlate(peaks.constData(), onsets.size() - 1, xcorr.data(), size,
+                             tempo.minLag(), lastLag, BandTempo::FFT, &correlator);
+    }));
+
+    QVector<float> tempoXcorr(size);
+    report(measure("tempo", seconds, frames, [&]() {
+        tempo.analyse(onsets, peaks.data(), tempoXcorr.data());
+    }));
+
+    OctaveResolver octave;
+    octave.setup(frameRate);
+    float bpm = tempo.bpm();
+    report(measure("octave", seconds, frames, [&]() {
+        octave.resolve(tempoXcorr.constData(), size, tempo.bpm());
+    }));
+    bpm = octave.resolve(tempoXcorr.constData(), size, bpm);
+
+    BeatTracker beats;
+    report(measure("beats", seconds, frames, [&]() {
+        beats.track(onsets, frameRate, bpm, envelope.band(SpectralFlux::BD));
+    }));
+
+    if (!json)
+        QTextStream(stdout) << "detected " << bpm << " bpm, " << beats.beats().count() << " beats\n";
+    delete engine;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("beatanalysis-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measure the analysis hot paths on synthetic buffers");
+    parser.addHelpOption();
+    QCommandLineOption jsonOption("json", "One json object per stage and length.");
+    QCommandLineOption presetOption(QStringList() << "p" << "preset",
+          "Frame engine: fast, standard or precise.", "preset", "fast");
+    QCommandLineOption lengthsOption(QStringList() << "l" << "lengths",
+          "Comma separated lengths in seconds (default: a 3 minute track and a 2 hour mix).", "secs", "180,7200");
+    QCommandLineOption timeOption(QStringList() << "t" << "min-time",
+          "Repeat every stage for at least <ms> milliseconds.", "ms", "500");
+    parser.addOption(jsonOption);
+    parser.addOption(presetOption);
+    parser.addOption(lengthsOption);
+    parser.addOption(timeOption);
+    parser.process(a);
+
+    json = parser.isSet(jsonOption);
+    minTime = parser.value(timeOption).toLongLong();
+    presetName = parser.value(presetOption).toLower();
+    FrameEngine::presetType preset = FrameEngine::FAST;
+    if (presetName == "standard")
+        preset = FrameEngine::STANDARD;
+    else if (presetName == "precise")
+        preset = FrameEngine::PRECISE;
+    else if (presetName != "fast") {
+        qWarning("Unknown preset %s", qPrintable(presetName));
+        return 1;
+    }
+
+    foreach (const QString &length, parser.value(lengthsOption).split(',')) {
+        int seconds = length.toInt();
+        if (seconds > 0)
+            run(preset, seconds);
+    }
+    return 0;
+}
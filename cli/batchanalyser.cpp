@@ -0,0 +1,261 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchanalyser.h"
+#include "analysercore.h"
+#include "analyserpool.h"
+#include "resultcache.h"
+#include "pcmfile.h"
+
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+struct BatchAnalyser::Worker
+{
+        AnalyserCore *analyser;
+        QString file;
+        QElapsedTimer clock;
+};
+
+BatchAnalyser::BatchAnalyser(QObject *parent) :
+        QObject(parent),
+    m_pool(0), m_next(0), m_done(0), m_workerCount(QThread::idealThreadCount()), m_earlyStop(0)
+    , m_scanWindows(0), m_scanSeconds(0), m_rate(44100), m_mono(false)
+    , m_preset(FrameEngine::FAST), m_pipelined(false), m_cache(0), m_envelopeFlags(0)
+    , m_octaveCorrection(true), m_instrumentation(false)
+    , m_gainElements(false), m_pcmFastPath(true)
+    , m_chunks(0), m_chunkSeconds(600)
+    , m_rawRate(44100), m_rawChannels(2), m_rawType(PcmFile::S16)
+    , m_format(JSON), m_output(0)
+{
+}
+
+BatchAnalyser::~BatchAnalyser()
+{
+    qDeleteAll(m_workers);
+    delete m_pool;
+    delete m_cache;
+}
+
+void BatchAnalyser::setCache(const QString &fileName, bool contentHash)
+{
+    delete m_cache;
+    m_cache = new ResultCache(fileName);
+    m_cache->setContentHash(contentHash);
+}
+
+void BatchAnalyser::addPath(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.isDir()) {
+        m_files.append(info.absoluteFilePath());
+        return;
+    }
+
+    //collect all known audio files below the given folder, stored envelopes only count
+    //when named on their own, the ones of --envelopes may lie in a scanned folder
+    QStringList filters;
+    filters << "*.mp3" << "*.ogg" << "*.oga" << "*.flac" << "*.wav" << "*.aif" << "*.aiff" << "*.aifc"
+            << "*.m4a" << "*.aac" << "*.wma" << "*.opus";
+    QStringList found;
+    QDirIterator it(info.absoluteFilePath(), filters, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while (it.hasNext())
+        found.append(it.next());
+    found.sort();
+    m_files.append(found);
+}
+
+void BatchAnalyser::addList(const QString &listFile)
+{
+    QFile file;
+    if (listFile == "-")
+        file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    else {
+        file.setFileName(listFile);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << Q_FUNC_INFO << ": can not read list" << listFile;
+            return;
+        }
+    }
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            addPath(line);
+    }
+}
+
+void BatchAnalyser::setWorkers(int workers)
+{
+    m_workerCount = qMax(1, workers);
+}
+
+void BatchAnalyser::start()
+{
+    m_clock.start();
+
+    if (m_format == CSV && m_output)
+        m_output->write("file,bpm,gain_db,start_ms,end_ms,length_ms,analysis_ms,cached\n");
+
+    //one analysis pipeline per worker, each one runs a whole track at a time
+    int workers = qMin(m_workerCount, m_files.count());
+    m_pool = new AnalyserPool(workers);
+    for (int i = 0; i < workers; i++) {
+        Worker *worker = new Worker;
+        worker->analyser = 0;
+        m_workers.append(worker);
+        startNext(worker);
+    }
+
+    if (workers == 0)
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+bool BatchAnalyser::startNext(Worker *worker)
+{
+    if (m_next >= m_files.count())
+        return false;
+
+    worker->file = m_files.at(m_next++);
+    worker->clock.start();
+    worker->analyser = m_pool->acquire();
+    worker->analyser->setEarlyStop(m_earlyStop);
+    worker->analyser->setAnalysisRate(m_rate, m_mono);
+    worker->analyser->setPreset(m_preset);
+    worker->analyser->setPipelined(m_pipelined);
+    worker->analyser->setCache(m_cache);
+    worker->analyser->setOctaveCorrection(m_octaveCorrection);
+    worker->analyser->setInstrumentation(m_instrumentation);
+    worker->analyser->setGainElements(m_gainElements);
+    worker->analyser->setPcmFastPath(m_pcmFastPath);
+    //without a count the cores left over by the workers decode the parts of long tracks
+    worker->analyser->setChunking(m_chunks > 0 ? m_chunks : qMax(1, QThread::idealThreadCount() / m_workerCount),
+                                  m_chunkSeconds);
+    worker->analyser->setRawFormat(m_rawRate, m_rawChannels, m_rawType);
+    for (int b = 0; b < m_bandWeights.count(); b++)
+        worker->analyser->setBandWeight(b, m_bandWeights.at(b));
+    if (m_scanWindows > 0) {
+        worker->analyser->setMode(AnalyserCore::TEMPO);
+        worker->analyser->setScanWindows(m_scanWindows, m_scanSeconds);
+    }
+    if (m_envelopeDir.isEmpty())
+        worker->analyser->setEnvelopeFile(QString());
+    else {
+        // tracks of the same name in different folders each keep their own envelope
+        QByteArray pathHash = QCryptographicHash::hash(worker->file.toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+        worker->analyser->setEnvelopeFile(m_envelopeDir + "/" + QFileInfo(worker->file).completeBaseName()
+                                          + "-" + pathHash + ".onsets", m_envelopeFlags);
+    }
+    connect(worker->analyser, SIGNAL(finishTempo()), this, SLOT(trackFinished()), Qt::QueuedConnection);
+
+    // stored envelopes only need the tempo detection
+    if (worker->file.endsWith(".onsets")) {
+        if (!worker->analyser->openEnvelope(worker->file))
+            QMetaObject::invokeMethod(worker->analyser, "finishTempo", Qt::QueuedConnection);
+    }
+    else
+        worker->analyser->open(QUrl::fromLocalFile(worker->file));
+    return true;
+}
+
+void BatchAnalyser::trackFinished()
+{
+    AnalyserCore *analyser = qobject_cast<AnalyserCore*>(sender());
+    Worker *worker = 0;
+    foreach (Worker *w, m_workers)
+        if (w->analyser == analyser)
+            worker = w;
+    if (!worker)
+        return;
+
+    writeResult(worker);
+    m_done++;
+
+    disconnect(analyser, SIGNAL(finishTempo()), this, SLOT(trackFinished()));
+    m_pool->release(analyser);
+    worker->analyser = 0;
+
+    if (!startNext(worker)) {
+        if (m_done == m_files.count()) {
+            qDebug() << Q_FUNC_INFO << ":" << m_done << "tracks in" << m_clock.elapsed() << "ms";
+            Q_EMIT finished();
+        }
+    }
+}
+
+void BatchAnalyser::writeResult(Worker *worker)
+{
+    if (!m_output)
+        return;
+
+    AnalyserCore *analyser = worker->analyser;
+    QTime zero(0,0);
+    int startMs = zero.msecsTo(analyser->startPosition());
+    int endMs = zero.msecsTo(analyser->endPosition());
+    int lengthMs = zero.msecsTo(analyser->length());
+    qint64 elapsed = worker->clock.elapsed();
+
+    if (m_format == CSV) {
+        QString file = worker->file;
+        file.replace('"', "\"\"");
+        QString line = QString("\"%1\",%2,%3,%4,%5,%6,%7,%8\n")
+                .arg(file)
+                .arg(analyser->bpm())
+                .arg(analyser->gainDB(), 0, 'f', 2)
+                .arg(startMs)
+                .arg(endMs)
+                .arg(lengthMs)
+                .arg(elapsed)
+                .arg(analyser->cached() ? 1 : 0);
+        m_output->write(line.toUtf8());
+    }
+    else {
+        QJsonObject result;
+        result["file"] = worker->file;
+        result["bpm"] = analyser->bpm();
+        result["gain_db"] = analyser->gainDB();
+        result["start_ms"] = startMs;
+        result["end_ms"] = endMs;
+        result["length_ms"] = lengthMs;
+        result["analysis_ms"] = elapsed;
+        result["cached"] = analyser->cached();
+        result["confidence"] = analyser->confidence();
+        result["octave_confidence"] = analyser->octaveConfidence();
+        QList<QTime> beats = analyser->beats();
+        QList<QTime> downbeats = analyser->downbeats();
+        result["beat_count"] = beats.count();
+        if (!beats.isEmpty())
+            result["first_beat_ms"] = zero.msecsTo(beats.first());
+        if (!downbeats.isEmpty())
+            result["first_downbeat_ms"] = zero.msecsTo(downbeats.first());
+        QJsonObject bands;
+        const char *names[SpectralFlux::BAND_COUNT] = { "all", "bd", "sd", "hh" };
+        for (int b = 0; b < SpectralFlux::BAND_COUNT; b++) {
+            QJsonObject band;
+            band["bpm"] = analyser->bandBpm(b);
+            band["confidence"] = analyser->bandConfidence(b);
+            bands[names[b]] = band;
+        }
+        result["bands"] = bands;
+        if (m_instrumentation)
+            result["stats"] = analyser->stats().toJson();
+        m_output->write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+        m_output->write("\n");
+    }
+}
@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BATCHANALYSER_H
+#define BATCHANALYSER_H
+
+#include <QtCore>
+
+#include "frameengine.h"
+
+class AnalyserCore;
+class AnalyserPool;
+class ResultCache;
+
+class BatchAnalyser : public QObject
+{
+    Q_OBJECT
+public:
+    BatchAnalyser(QObject *parent = 0);
+    ~BatchAnalyser();
+
+    enum formatType { JSON, CSV };
+
+    void addPath(const QString &path);
+    void addList(const QString &listFile);
+    int count() {return m_files.count();}
+
+    void setWorkers(int workers);
+    void setFormat(formatType format) {m_format = format;}
+    void setOutput(QIODevice *output) {m_output = output;}
+    void setEarlyStop(int stableSecs) {m_earlyStop = stableSecs;}
+    void setScan(int windows, int seconds) {m_scanWindows = windows; m_scanSeconds = seconds;}
+    void setAnalysisRate(int rate, bool mono) {m_rate = rate; m_mono = mono;}
+    void setPreset(FrameEngine::presetType preset) {m_preset = preset;}
+    void setPipelined(bool pipelined) {m_pipelined = pipelined;}
+    void setCache(const QString &fileName, bool contentHash);
+    void setBandWeights(const QList<float> &weights) {m_bandWeights = weights;}
+    void setOctaveCorrection(bool enabled) {m_octaveCorrection = enabled;}
+    void setInstrumentation(bool enabled) {m_instrumentation = enabled;}
+    void setGainElements(bool enabled) {m_gainElements = enabled;}
+    void setPcmFastPath(bool enabled) {m_pcmFastPath = enabled;}
+    void setChunking(int chunks, int minSeconds) {m_chunks = chunks; m_chunkSeconds = minSeconds;}
+    void setRawFormat(int rate, int channels, int type) {m_rawRate = rate; m_rawChannels = channels; m_rawType = type;}
+    void setEnvelopes(const QString &dir, int flags) {m_envelopeDir = dir; m_envelopeFlags = flags;}
+
+    void start();
+
+ Q_SIGNALS:
+    void finished();
+
+ private slots:
+    void trackFinished();
+
+ private:
+    struct Worker;
+    QList<Worker*> m_workers;
+    AnalyserPool *m_pool;
+    QStringList m_files;
+    int m_next;
+    int m_done;
+    int m_workerCount;
+    int m_earlyStop;
+    int m_scanWindows;
+    int m_scanSeconds;
+    int m_rate;
+    bool m_mono;
+    FrameEngine::presetType m_preset;
+    bool m_pipelined;
+    ResultCache *m_cache;
+    QString m_envelopeDir;
+    QList<float> m_bandWeights;
+    bool m_octaveCorrection;
+    bool m_instrumentation;
+    bool m_gainElements;
+    bool m_pcmFastPath;
+    int m_chunks;
+    int m_chunkSeconds;
+    int m_rawRate;
+    int m_rawChannels;
+    int m_rawType;
+    int m_envelopeFlags;
+    formatType m_format;
+    QIODevice *m_output;
+    QElapsedTimer m_clock;
+
+    bool startNext(Worker *worker);
+    void writeResult(Worker *worker);
+};
+
+#endif // BATCHANALYSER_H
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Headless batch analyser, scans a music library with
+# one analysis pipeline per worker
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = beatanalysis-cli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    batchanalyser.cpp
+
+HEADERS += batchanalyser.h
+
+include(../core.pri)
@@ -0,0 +1,201 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "batchanalyser.h"
+#include "envelopefile.h"
+#include "pcmfile.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("beatanalysis-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Analyse tempo, gain and start/end positions of audio files");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Audio files or folders to scan.", "[paths...]");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+          "Number of concurrent analyses (default: number of cores).", "n");
+    QCommandLineOption listOption(QStringList() << "l" << "list",
+          "Read files or folders line by line from <file>, - for stdin.", "file");
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+          "Output format: json (one object per line) or csv.", "format", "json");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+          "Write results to <file> instead of stdout.", "file");
+    QCommandLineOption earlyStopOption(QStringList() << "s" << "early-stop",
+          "Stop decoding once the tempo estimate held for <secs> seconds (gain stays invalid).", "secs");
+    QCommandLineOption scanOption("scan",
+          "Sampled scan: decode only <n> windows spread over each track (gain stays invalid).", "n");
+    QCommandLineOption scanLengthOption("scan-length",
+          "Length of each scan window in seconds.", "secs", "30");
+    QCommandLineOption rateOption(QStringList() << "r" << "rate",
+          "Analysis sample rate in Hz, e.g. 11025 or 22050, 0 for the native rate.", "hz", "44100");
+    QCommandLineOption monoOption("mono", "Downmix to mono in the pipeline.");
+    QCommandLineOption presetOption(QStringList() << "p" << "preset",
+          "Frame engine: fast (128 point fft every 512 samples), standard (512/512) or precise (1024/256).", "preset", "fast");
+    QCommandLineOption pipelinedOption("pipelined",
+          "Decode and analyse each track in two threads.");
+    QCommandLineOption cacheOption(QStringList() << "c" << "cache",
+          "Take known results from the result cache and add new ones to it.");
+    QCommandLineOption cacheFileOption("cache-file",
+          "Result cache to use instead of the default one.", "file");
+    QCommandLineOption contentHashOption("content-hash",
+          "Also find cached results of moved or touched files by their content.");
+    QCommandLineOption envelopesOption("envelopes",
+          "Store the onset envelopes of each track in <dir> as <name>-<path hash>.onsets, .onsets files named as arguments are analysed from them.", "dir");
+    QCommandLineOption envelopeFormatOption("envelope-format",
+          "Envelope encoding: float, 16bit or delta (16 bit deltas).", "format", "float");
+    QCommandLineOption bandWeightsOption("band-weights",
+          "Weights of the all, bass drum, snare and hi-hat bands in the tempo decision.", "all,bd,sd,hh", "1,0,0,0");
+    QCommandLineOption noOctaveOption("no-octave",
+          "Keep the tempo of the strongest correlation instead of resolving half or double tempo.");
+    QCommandLineOption gainElementsOption("gain-elements",
+          "Measure gain and silence with the rganalysis and cutter elements instead of the built-in R128 meter.");
+    QCommandLineOption noPcmOption("no-pcm-fast-path",
+          "Decode WAV and AIFF files through the pipeline instead of reading them directly.");
+    QCommandLineOption rawFormatOption("raw-format",
+          "Format of headerless .raw and .pcm files: rate, channels and u8, s8, s16, s24, s32, f32 or f64, little endian.",
+          "rate,channels,type", "44100,2,s16");
+    QCommandLineOption chunksOption("chunks",
+          "Decode long tracks as <n> parts in parallel, 1 turns it off (default: cores per job).", "n");
+    QCommandLineOption chunkLengthOption("chunk-threshold",
+          "Minimum length of a track to decode in parts.", "seconds", "600");
+    QCommandLineOption statsOption("stats",
+          "Time every stage of each track and add it to the json output.");
+    parser.addOption(jobsOption);
+    parser.addOption(listOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(earlyStopOption);
+    parser.addOption(scanOption);
+    parser.addOption(scanLengthOption);
+    parser.addOption(rateOption);
+    parser.addOption(monoOption);
+    parser.addOption(presetOption);
+    parser.addOption(pipelinedOption);
+    parser.addOption(cacheOption);
+    parser.addOption(cacheFileOption);
+    parser.addOption(contentHashOption);
+    parser.addOption(envelopesOption);
+    parser.addOption(envelopeFormatOption);
+    parser.addOption(bandWeightsOption);
+    parser.addOption(noOctaveOption);
+    parser.addOption(gainElementsOption);
+    parser.addOption(noPcmOption);
+    parser.addOption(rawFormatOption);
+    parser.addOption(chunksOption);
+    parser.addOption(chunkLengthOption);
+    parser.addOption(statsOption);
+    parser.process(a);
+
+    BatchAnalyser batch;
+    foreach (const QString &path, parser.positionalArguments())
+        batch.addPath(path);
+    foreach (const QString &list, parser.values(listOption))
+        batch.addList(list);
+
+    if (batch.count() == 0)
+        parser.showHelp(1);
+
+    if (parser.isSet(jobsOption))
+        batch.setWorkers(parser.value(jobsOption).toInt());
+
+    if (parser.isSet(earlyStopOption))
+        batch.setEarlyStop(parser.value(earlyStopOption).toInt());
+
+    if (parser.isSet(scanOption))
+        batch.setScan(parser.value(scanOption).toInt(), parser.value(scanLengthOption).toInt());
+
+    batch.setAnalysisRate(parser.value(rateOption).toInt(), parser.isSet(monoOption));
+    batch.setPipelined(parser.isSet(pipelinedOption));
+    if (parser.isSet(cacheOption) || parser.isSet(cacheFileOption))
+        batch.setCache(parser.value(cacheFileOption), parser.isSet(contentHashOption));
+
+    QString preset = parser.value(presetOption).toLower();
+    if (preset == "standard")
+        batch.setPreset(FrameEngine::STANDARD);
+    else if (preset == "precise")
+        batch.setPreset(FrameEngine::PRECISE);
+    else if (preset != "fast") {
+        qWarning("Unknown preset %s", qPrintable(preset));
+        return 1;
+    }
+
+    QList<float> weights;
+    foreach (const QString &weight, parser.value(bandWeightsOption).split(','))
+        weights.append(weight.toFloat());
+    if (weights.count() != SpectralFlux::BAND_COUNT) {
+        qWarning("Give %d band weights", SpectralFlux::BAND_COUNT);
+        return 1;
+    }
+    batch.setBandWeights(weights);
+    batch.setOctaveCorrection(!parser.isSet(noOctaveOption));
+    batch.setInstrumentation(parser.isSet(statsOption));
+    batch.setGainElements(parser.isSet(gainElementsOption));
+    batch.setPcmFastPath(!parser.isSet(noPcmOption));
+    batch.setChunking(parser.value(chunksOption).toInt(), parser.value(chunkLengthOption).toInt());
+
+    QStringList rawFormat = parser.value(rawFormatOption).split(',');
+    PcmFile::sampleType rawType = rawFormat.count() == 3 ? PcmFile::typeFromName(rawFormat.at(2).toLower()) : PcmFile::INVALID;
+    if (rawType == PcmFile::INVALID || rawFormat.at(0).toInt() <= 0 || rawFormat.at(1).toInt() <= 0) {
+        qWarning("Unknown raw format %s", qPrintable(parser.value(rawFormatOption)));
+        return 1;
+    }
+    batch.setRawFormat(rawFormat.at(0).toInt(), rawFormat.at(1).toInt(), rawType);
+
+    if (parser.isSet(envelopesOption)) {
+        QString envelopeFormat = parser.value(envelopeFormatOption).toLower();
+        int flags = 0;
+        if (envelopeFormat == "16bit")
+            flags = EnvelopeFile::QUANTIZED;
+        else if (envelopeFormat == "delta")
+            flags = EnvelopeFile::QUANTIZED | EnvelopeFile::DELTA;
+        else if (envelopeFormat != "float") {
+            qWarning("Unknown envelope format %s", qPrintable(envelopeFormat));
+            return 1;
+        }
+        QDir().mkpath(parser.value(envelopesOption));
+        batch.setEnvelopes(parser.value(envelopesOption), flags);
+    }
+
+    QString format = parser.value(formatOption).toLower();
+    if (format == "csv")
+        batch.setFormat(BatchAnalyser::CSV);
+    else if (format != "json") {
+        qWarning("Unknown format %s", qPrintable(format));
+        return 1;
+    }
+
+    QFile output;
+    if (parser.isSet(outputOption)) {
+        output.setFileName(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            qWarning("Can not write %s", qPrintable(output.fileName()));
+            return 1;
+        }
+    }
+    else
+        output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    batch.setOutput(&output);
+
+    QObject::connect(&batch, SIGNAL(finished()), &a, SLOT(quit()));
+    batch.start();
+
+    return a.exec();
+}
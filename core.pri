@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Links a target against the analysis core of
+# core/core.pro and the GStreamer libraries it needs,
+# shared by all targets which run an analysis
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+CONFIG += c++11
+
+greaterThan(QT_MAJOR_VERSION, 4): {
+    QT += concurrent
+    DEFINES += GST_API_VERSION_1
+}
+
+# all users of the core are one level below the top directory
+CORE_DIR = $$OUT_PWD/../core
+LIBS += -L$$CORE_DIR -lbeatanalysiscore
+unix: PRE_TARGETDEPS += $$CORE_DIR/libbeatanalysiscore.a
+
+macx {
+    INCLUDEPATH += /usr/local/include/gstreamer-1.0 \
+        /usr/local/include/glib-2.0 \
+        /usr/local/lib/glib-2.0/include \
+        /usr/local/include
+    LIBS += -L/usr/local/lib \
+        -lgstreamer-1.0 \
+        -lglib-2.0 \
+        -lgstfft-1.0 \
+        -lgstbase-1.0 \
+        -lgstapp-1.0 \
+        -lgstaudio-1.0 \
+        -lgobject-2.0
+}
+
+unix:!macx {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += gstreamer-1.0 \
+        gstreamer-fft-1.0 \
+        gstreamer-base-1.0 \
+        gstreamer-app-1.0 \
+        gstreamer-audio-1.0
+}
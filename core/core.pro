@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# The analysis core as a static library: pipeline,
+# dsp, result cache and analyser pool. Needs QtCore
+# and GStreamer only, no GUI
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = beatanalysiscore
+TEMPLATE = lib
+CONFIG += staticlib
+
+include(../dsp.pri)
+
+SOURCES += ../analysercore.cpp \
+    ../analyserpool.cpp \
+    ../samplering.cpp \
+    ../resultcache.cpp \
+    ../pcmfile.cpp
+
+HEADERS += ../analysercore.h \
+    ../analyserpool.h \
+    ../samplering.h \
+    ../resultcache.h \
+    ../pcmfile.h
+
+greaterThan(QT_MAJOR_VERSION, 4): {
+    QT += concurrent
+    DEFINES += GST_API_VERSION_1
+}
+
+unix:!macx {
+    PKGCONFIG += gstreamer-base-1.0 \
+        gstreamer-app-1.0 \
+        gstreamer-audio-1.0
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Generated test corpus with known tempo and silence,
+# and a runner which reports speed and accuracy of the
+# whole analyser per configuration
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = beatanalysis-corpus
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+    corpusgenerator.cpp \
+    corpusrunner.cpp
+
+HEADERS += corpusgenerator.h \
+    corpusrunner.h
+
+include(../core.pri)
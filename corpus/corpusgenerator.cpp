@@ -0,0 +1,251 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "corpusgenerator.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <math.h>
+
+#define LEAD_MS 2500
+#define TAIL_MS 4000
+
+CorpusGenerator::CorpusGenerator(const QString &dir) :
+    m_dir(dir), m_seconds(30)
+{
+}
+
+QList<CorpusTrack> CorpusGenerator::generate()
+{
+    QList<CorpusTrack> tracks;
+    QDir().mkpath(m_dir);
+
+    CorpusTrack track;
+    track.swing = 0;
+    track.rate = 44100;
+    track.channels = 1;
+    track.startMs = LEAD_MS;
+    track.endMs = LEAD_MS + m_seconds * 1000;
+    track.lengthMs = track.endMs + TAIL_MS;
+
+    // the usual tempo range, plain and with swing
+    const float bpms[] = { 70, 90, 100, 120, 128, 140, 160, 174 };
+    for (unsigned i = 0; i < sizeof(bpms) / sizeof(bpms[0]); i++) {
+        track.bpm = track.endBpm = bpms[i];
+        track.swing = 0;
+        track.kind = "click";
+        tracks.append(track);
+        track.kind = "drums";
+        tracks.append(track);
+        track.swing = 0.33f;
+        tracks.append(track);
+    }
+
+    // ramps up and down by a few percent, like a live drummer or a dj transition
+    track.kind = "drums";
+    track.swing = 0;
+    track.bpm = 120;
+    track.endBpm = 126;
+    tracks.append(track);
+    track.bpm = 140;
+    track.endBpm = 134;
+    tracks.append(track);
+
+    // other sample rates
+    const int rates[] = { 22050, 48000, 96000 };
+    track.bpm = track.endBpm = 128;
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        track.rate = rates[i];
+        tracks.append(track);
+    }
+
+    // stereo, the gain must not depend on the channels of the analysis
+    track.rate = 44100;
+    track.channels = 2;
+    tracks.append(track);
+    track.kind = "click";
+    tracks.append(track);
+
+    QJsonArray manifest;
+    for (int i = 0; i < tracks.count(); i++) {
+        CorpusTrack &t = tracks[i];
+        t.file = QString("%1-%2bpm%3%4-%5hz%6.wav")
+                .arg(t.kind)
+                .arg(t.bpm, 0, 'f', 0)
+                .arg(t.endBpm != t.bpm ? QString("-to-%1").arg(t.endBpm, 0, 'f', 0) : QString())
+                .arg(t.swing > 0 ? "-swing" : "")
+                .arg(t.rate)
+                .arg(t.channels == 2 ? "-stereo" : "");
+        if (!render(t))
+            return QList<CorpusTrack>();
+
+        QJsonObject entry;
+        entry["file"] = t.file;
+        entry["kind"] = t.kind;
+        entry["bpm"] = t.bpm;
+        entry["end_bpm"] = t.endBpm;
+        entry["swing"] = t.swing;
+        entry["rate"] = t.rate;
+        entry["channels"] = t.channels;
+        entry["start_ms"] = t.startMs;
+        entry["end_ms"] = t.endMs;
+        entry["length_ms"] = t.lengthMs;
+        manifest.append(entry);
+    }
+
+    QFile file(m_dir + "/corpus.json");
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << ": can not write" << file.fileName();
+        return QList<CorpusTrack>();
+    }
+    file.write(QJsonDocument(manifest).toJson());
+    return tracks;
+}
+
+QList<CorpusTrack> CorpusGenerator::load(const QString &dir)
+{
+    QList<CorpusTrack> tracks;
+    QFile file(dir + "/corpus.json");
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << ": no corpus in" << dir;
+        return tracks;
+    }
+
+    QJsonArray manifest = QJsonDocument::fromJson(file.readAll()).array();
+    for (int i = 0; i < manifest.count(); i++) {
+        QJsonObject entry = manifest.at(i).toObject();
+        CorpusTrack track;
+        track.file = dir + "/" + entry["file"].toString();
+        track.kind = entry["kind"].toString();
+        track.bpm = entry["bpm"].toDouble();
+        track.endBpm = entry["end_bpm"].toDouble();
+        track.swing = entry["swing"].toDouble();
+        track.rate = entry["rate"].toInt();
+        track.channels = entry["channels"].toInt(1);
+        track.startMs = entry["start_ms"].toInt();
+        track.endMs = entry["end_ms"].toInt();
+        track.lengthMs = entry["length_ms"].toInt();
+        tracks.append(track);
+    }
+    return tracks;
+}
+
+bool CorpusGenerator::render(const CorpusTrack &track)
+{
+    int rate = track.rate;
+    int lead = (qint64)track.startMs * rate / 1000;
+    int end = (qint64)track.endMs * rate / 1000;
+    QVector<qint16> samples((qint64)track.lengthMs * rate / 1000, 0);
+
+    quint32 seed = 1;
+    int kick = -1, snare = -1, hat = -1, click = -1;
+    bool accent = false;
+    double beatPosition = 0;
+    float lastFraction = 0;
+    int lastBeat = -1;
+    for (int i = lead; i < end; i++) {
+        // tempo ramps linearly, the position in beats is its integral
+        double t = (double)(i - lead) / (end - lead);
+        double bpm = track.bpm + (track.endBpm - track.bpm) * t;
+        int beat = (int)beatPosition;
+        float fraction = beatPosition - beat;
+        float offBeat = 0.5f + track.swing / 2;
+
+        if (beat != lastBeat) {
+            if (track.kind == "click") {
+                click = 0;
+                accent = beat % 4 == 0;
+            } else {
+                if (beat % 2 == 0)
+                    kick = 0;
+                else
+                    snare = 0;
+                hat = 0;
+            }
+            lastBeat = beat;
+        }
+        else if (lastFraction < offBeat && fraction >= offBeat && track.kind == "drums")
+            hat = 0;
+        lastFraction = fraction;
+        beatPosition += bpm / 60.0 / rate;
+
+        seed = seed * 1664525 + 1013904223;
+        float noise = (seed >> 8) / 8388608.0f - 1.0f;
+        float sample = 0;
+        if (click >= 0) {
+            float f = accent ? 1500 : 1000;
+            sample += 0.8f * sinf(2 * M_PI * f * click / rate) * expf(-click * 300.0f / rate);
+            if (++click > rate / 50) click = -1;
+        }
+        if (kick >= 0) {
+            // a falling pitch gives the thump
+            float f = 50 + 80 * expf(-kick * 30.0f / rate);
+            sample += 0.8f * sinf(2 * M_PI * f * kick / rate) * expf(-kick * 12.0f / rate);
+            if (++kick > rate / 3) kick = -1;
+        }
+        if (snare >= 0) {
+            sample += (0.4f * noise + 0.3f * sinf(2 * M_PI * 180 * snare / rate)) * expf(-snare * 25.0f / rate);
+            if (++snare > rate / 4) snare = -1;
+        }
+        if (hat >= 0) {
+            sample += 0.2f * noise * expf(-hat * 120.0f / rate);
+            if (++hat > rate / 20) hat = -1;
+        }
+        samples[i] = qBound(-32767, (int)(sample * 0.7f * 32767), 32767);
+    }
+
+    return writeWav(m_dir + "/" + track.file, samples, rate, track.channels);
+}
+
+static void putLe(QByteArray &out, quint32 value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.append((char)((value >> (8 * i)) & 0xff));
+}
+
+bool CorpusGenerator::writeWav(const QString &fileName, const QVector<qint16> &samples, int rate, int channels)
+{
+    quint32 dataSize = samples.count() * channels * sizeof(qint16);
+    QByteArray header;
+    header.append("RIFF");
+    putLe(header, 36 + dataSize, 4);
+    header.append("WAVEfmt ");
+    putLe(header, 16, 4);           // fmt chunk size
+    putLe(header, 1, 2);            // pcm
+    putLe(header, channels, 2);
+    putLe(header, rate * channels * 2, 4);  // bytes per second
+    putLe(header, channels * 2, 2);         // bytes per frame
+    putLe(header, 16, 2);           // bits
+    header.append("data");
+    putLe(header, dataSize, 4);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << ": can not write" << fileName;
+        return false;
+    }
+    file.write(header);
+    QByteArray data(dataSize, 0);
+    for (int i = 0; i < samples.count() * channels; i++) {
+        quint16 value = samples.at(i / channels);
+        data[2 * i] = (char)(value & 0xff);
+        data[2 * i + 1] = (char)(value >> 8);
+    }
+    return file.write(data) == (qint64)dataSize;
+}
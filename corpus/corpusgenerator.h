@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QtCore>
+
+// A track of the corpus and what the analyser should find in it
+struct CorpusTrack
+{
+    QString file;
+    QString kind;       // click or drums
+    float bpm;          // at the start
+    float endBpm;       // at the end, differs for tempo ramps
+    float swing;        // delay of the off beats in eighths, 0 is straight
+    int rate;
+    int channels;       // stereo tracks carry the same signal on both
+    int startMs;        // sound starts after the leading silence
+    int endMs;          // and stops before the trailing one
+    int lengthMs;
+
+    // tempo a listener taps, the mean of a ramp
+    float trueBpm() const {return (bpm + endBpm) / 2;}
+};
+
+// Renders click tracks and drum patterns of known tempo as 16 bit mono or
+// stereo wav files and a corpus.json describing them. The noise is seeded, so the same
+// corpus comes out on every machine.
+class CorpusGenerator
+{
+public:
+    explicit CorpusGenerator(const QString &dir);
+
+    void setSeconds(int seconds) {m_seconds = seconds;}
+
+    QList<CorpusTrack> generate();
+    static QList<CorpusTrack> load(const QString &dir);
+
+private:
+    QString m_dir;
+    int m_seconds;
+
+    bool render(const CorpusTrack &track);
+    static bool writeWav(const QString &fileName, const QVector<qint16> &samples, int rate, int channels);
+};
+
+#endif // CORPUSGENERATOR_H
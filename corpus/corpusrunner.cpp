@@ -0,0 +1,195 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "corpusrunner.h"
+#include "analysercore.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <sys/resource.h>
+
+// a tempo within 4 percent counts as found
+#define TOLERANCE 0.04
+#define TIMEOUT_MS 120000
+// configurations may differ by rounding, not by a channel count
+#define GAIN_TOLERANCE_DB 0.1
+
+CorpusRunner::CorpusRunner(QObject *parent) :
+    QObject(parent), m_verbose(false), m_json(false), m_output(0)
+{
+}
+
+bool CorpusRunner::parseConfig(const QString &text, Config *config)
+{
+    QStringList options = text.split('+');
+    QStringList engine = options.takeFirst().split('@');
+    QString preset = engine.value(0).toLower();
+    if (preset == "fast")
+        config->preset = FrameEngine::FAST;
+    else if (preset == "standard")
+        config->preset = FrameEngine::STANDARD;
+    else if (preset == "precise")
+        config->preset = FrameEngine::PRECISE;
+    else
+        return false;
+
+    config->rate = engine.count() > 1 ? engine.at(1).toInt() : 44100;
+    config->mono = options.contains("mono");
+    config->pipelined = options.contains("pipelined");
+    config->decoded = options.contains("decoded");
+    config->name = text;
+    return true;
+}
+
+qint64 CorpusRunner::peakRss()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return (qint64)usage.ru_maxrss * 1024; // kilobytes on linux
+}
+
+void CorpusRunner::write(const QJsonObject &object, const QString &text)
+{
+    if (m_json)
+        m_output->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n");
+    else
+        m_output->write(text.toUtf8() + "\n");
+}
+
+bool CorpusRunner::analyse(AnalyserCore *analyser, const QString &file)
+{
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    connect(&timeout, SIGNAL(timeout()), &loop, SLOT(quit()));
+    connect(analyser, SIGNAL(finishTempo()), &loop, SLOT(quit()), Qt::QueuedConnection);
+    timeout.start(TIMEOUT_MS);
+    analyser->open(QUrl::fromLocalFile(file));
+    loop.exec();
+    disconnect(analyser, SIGNAL(finishTempo()), &loop, SLOT(quit()));
+    return timeout.isActive();
+}
+
+void CorpusRunner::run(const QList<CorpusTrack> &tracks, const QList<Config> &configs, QIODevice *output)
+{
+    m_output = output;
+    if (!m_json)
+        write(QJsonObject(), "config                     files  realtime  peak_rss  bpm_err  found  octave  start_err  end_err  gain_diff");
+    m_referenceGain.clear();
+    foreach (const Config &config, configs)
+        runConfig(tracks, config);
+}
+
+void CorpusRunner::runConfig(const QList<CorpusTrack> &tracks, const Config &config)
+{
+    AnalyserCore analyser;
+    analyser.setPreset(config.preset);
+    analyser.setAnalysisRate(config.rate, config.mono);
+    analyser.setPipelined(config.pipelined);
+    analyser.setPcmFastPath(!config.decoded);
+
+    int done = 0, found = 0, octave = 0;
+    double bpmError = 0, startError = 0, endError = 0, gainDiff = 0;
+    bool reference = m_referenceGain.isEmpty();
+    qint64 audioMs = 0, wallNs = 0;
+    QTime zero(0,0);
+
+    foreach (const CorpusTrack &track, tracks) {
+        QElapsedTimer clock;
+        clock.start();
+        if (!analyse(&analyser, track.file)) {
+            qWarning() << Q_FUNC_INFO << ": timeout on" << track.file;
+            analyser.reset();
+            continue;
+        }
+        qint64 elapsed = clock.nsecsElapsed();
+
+        float truth = track.trueBpm();
+        float bpm = analyser.bpm();
+        double ratio = truth > 0 ? bpm / truth : 0;
+        bool hit = qAbs(ratio - 1) <= TOLERANCE;
+        bool octaveError = qAbs(ratio - 0.5) <= TOLERANCE / 2 || qAbs(ratio - 2) <= TOLERANCE * 2;
+        int startMs = zero.msecsTo(analyser.startPosition());
+        int endMs = zero.msecsTo(analyser.endPosition());
+        double gain = analyser.gainDB();
+        if (reference)
+            m_referenceGain.insert(track.file, gain);
+        else if (m_referenceGain.contains(track.file)) {
+            double diff = qAbs(gain - m_referenceGain.value(track.file));
+            gainDiff = qMax(gainDiff, diff);
+            if (diff > GAIN_TOLERANCE_DB)
+                qWarning() << Q_FUNC_INFO << ":" << config.name << "gain of" << track.file
+                           << "differs by" << diff << "dB from the first configuration";
+        }
+
+        done++;
+        found += hit;
+        octave += octaveError;
+        if (!octaveError)
+            bpmError += qAbs(bpm - truth);
+        startError += qAbs(startMs - track.startMs);
+        endError += qAbs(endMs - track.endMs);
+        audioMs += track.lengthMs;
+        wallNs += elapsed;
+
+        if (m_verbose) {
+            QJsonObject result;
+            result["config"] = config.name;
+            result["file"] = QFileInfo(track.file).fileName();
+            result["true_bpm"] = truth;
+            result["bpm"] = bpm;
+            result["octave_error"] = octaveError;
+            result["start_error_ms"] = startMs - track.startMs;
+            result["end_error_ms"] = endMs - track.endMs;
+            result["gain_db"] = gain;
+            result["analysis_ms"] = elapsed / 1000000;
+            write(result, QString("  %1 %2 bpm (true %3) start %4 ms end %5 ms")
+                  .arg(QFileInfo(track.file).fileName(), -40)
+                  .arg(bpm, 4).arg(truth, 0, 'f', 1)
+                  .arg(startMs - track.startMs).arg(endMs - track.endMs));
+        }
+        analyser.reset();
+    }
+
+    int correct = done - octave;
+    double realtime = wallNs > 0 ? audioMs * 1e6 / wallNs : 0;
+    double rssMb = peakRss() / 1048576.0;
+    QJsonObject summary;
+    summary["config"] = config.name;
+    summary["files"] = done;
+    summary["realtime_factor"] = realtime;
+    summary["peak_rss_mb"] = rssMb;
+    summary["bpm_error"] = correct > 0 ? bpmError / correct : 0;
+    summary["found_rate"] = done > 0 ? (double)found / done : 0;
+    summary["octave_error_rate"] = done > 0 ? (double)octave / done : 0;
+    summary["start_error_ms"] = done > 0 ? startError / done : 0;
+    summary["end_error_ms"] = done > 0 ? endError / done : 0;
+    summary["gain_diff_db"] = gainDiff;
+    write(summary, QString("%1 %2 %3x %4 MB %5 %6% %7% %8 ms %9 ms %10 dB")
+          .arg(config.name, -26)
+          .arg(done, 5)
+          .arg(realtime, 8, 'f', 1)
+          .arg(rssMb, 6, 'f', 1)
+          .arg(summary["bpm_error"].toDouble(), 8, 'f', 2)
+          .arg(summary["found_rate"].toDouble() * 100, 5, 'f', 1)
+          .arg(summary["octave_error_rate"].toDouble() * 100, 6, 'f', 1)
+          .arg(summary["start_error_ms"].toDouble(), 7, 'f', 0)
+          .arg(summary["end_error_ms"].toDouble(), 7, 'f', 0)
+          .arg(gainDiff, 7, 'f', 2));
+}
@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORPUSRUNNER_H
+#define CORPUSRUNNER_H
+
+#include <QtCore>
+
+#include "corpusgenerator.h"
+#include "frameengine.h"
+
+class AnalyserCore;
+
+// Runs the corpus through the whole analyser once per configuration and
+// reports speed and accuracy: realtime factor, peak resident memory, bpm
+// error, how often the tempo came out at half or double, and the error of
+// the start and end positions.
+class CorpusRunner : public QObject
+{
+    Q_OBJECT
+public:
+    struct Config {
+        QString name;
+        FrameEngine::presetType preset;
+        int rate;
+        bool mono;      // analyse a downmix instead of two channels
+        bool pipelined;
+        bool decoded;   // the wav files through the pipeline, not mapped
+    };
+
+    CorpusRunner(QObject *parent = 0);
+
+    // preset@rate, e.g. fast@44100 or precise@22050+pipelined+decoded+mono
+    static bool parseConfig(const QString &text, Config *config);
+
+    void setVerbose(bool verbose) {m_verbose = verbose;}
+    void setJson(bool json) {m_json = json;}
+    void run(const QList<CorpusTrack> &tracks, const QList<Config> &configs, QIODevice *output);
+
+private:
+    bool m_verbose;
+    bool m_json;
+    QIODevice *m_output;
+    // gain of every file in the first configuration, the others must match it
+    QHash<QString, double> m_referenceGain;
+
+    void runConfig(const QList<CorpusTrack> &tracks, const Config &config);
+    bool analyse(AnalyserCore *analyser, const QString &file);
+    void write(const QJsonObject &object, const QString &text);
+    static qint64 peakRss();
+};
+
+#endif // CORPUSRUNNER_H
@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "corpusgenerator.h"
+#include "corpusrunner.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("beatanalysis-corpus");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate a corpus of known tempo and measure the analyser on it");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "generate or run.");
+    parser.addPositionalArgument("dir", "Folder of the corpus.");
+    QCommandLineOption secondsOption("seconds",
+          "Length of the sound of each generated track.", "secs", "30");
+    QCommandLineOption configOption(QStringList() << "c" << "config",
+          "Configuration to run as preset@rate[+pipelined][+decoded][+mono], may be repeated.", "config");
+    QCommandLineOption jsonOption("json", "One json object per configuration.");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Report every track as well.");
+    parser.addOption(secondsOption);
+    parser.addOption(configOption);
+    parser.addOption(jsonOption);
+    parser.addOption(verboseOption);
+    parser.process(a);
+
+    QStringList args = parser.positionalArguments();
+    if (args.count() != 2)
+        parser.showHelp(1);
+    QString command = args.at(0);
+    QString dir = args.at(1);
+
+    if (command == "generate") {
+        CorpusGenerator generator(dir);
+        generator.setSeconds(parser.value(secondsOption).toInt());
+        return generator.generate().isEmpty() ? 1 : 0;
+    }
+    if (command != "run")
+        parser.showHelp(1);
+
+    QList<CorpusTrack> tracks = CorpusGenerator::load(dir);
+    if (tracks.isEmpty())
+        return 1;
+
+    QStringList names = parser.values(configOption);
+    if (names.isEmpty())
+        names << "fast@44100" << "fast@22050" << "standard@44100" << "precise@44100";
+    QList<CorpusRunner::Config> configs;
+    foreach (const QString &name, names) {
+        CorpusRunner::Config config;
+        if (!CorpusRunner::parseConfig(name, &config)) {
+            qWarning("Unknown configuration %s", qPrintable(name));
+            return 1;
+        }
+        configs.append(config);
+    }
+
+    QFile output;
+    output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    CorpusRunner runner;
+    runner.setJson(parser.isSet(jsonOption));
+    runner.setVerbose(parser.isSet(verboseOption));
+    runner.run(tracks, configs, &output);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#-------------------------------------------------
+#
+# The signal processing of the analysis: frame engine,
+# onset envelopes, tempo and beats. Needs no pipeline,
+# only the fft of GStreamer
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+
+CONFIG += c++11
+
+SOURCES += $$PWD/autocorrelation.cpp \
+    $$PWD/spectralflux.cpp \
+    $$PWD/onsetenvelope.cpp \
+    $$PWD/onlinetempo.cpp \
+    $$PWD/frameengine.cpp \
+    $$PWD/onsetthreshold.cpp \
+    $$PWD/envelopefile.cpp \
+    $$PWD/bandtempo.cpp \
+    $$PWD/beattracker.cpp \
+    $$PWD/octaveresolver.cpp \
+    $$PWD/analysisstats.cpp \
+    $$PWD/loudnessmeter.cpp
+
+HEADERS += $$PWD/autocorrelation.h \
+    $$PWD/spectralflux.h \
+    $$PWD/onsetenvelope.h \
+    $$PWD/onlinetempo.h \
+    $$PWD/frameengine.h \
+    $$PWD/onsetthreshold.h \
+    $$PWD/envelopefile.h \
+    $$PWD/bandtempo.h \
+    $$PWD/beattracker.h \
+    $$PWD/octaveresolver.h \
+    $$PWD/analysisstats.h \
+    $$PWD/loudnessmeter.h
+
+macx {
+    INCLUDEPATH += /usr/local/include/gstreamer-1.0 \
+        /usr/local/include/glib-2.0 \
+        /usr/local/lib/glib-2.0/include \
+        /usr/local/include
+    LIBS += -L/usr/local/lib \
+        -lgstreamer-1.0 \
+        -lglib-2.0 \
+        -lgstfft-1.0 \
+        -lgobject-2.0
+}
+
+unix:!macx {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += gstreamer-1.0 \
+        gstreamer-fft-1.0
+}
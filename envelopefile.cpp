@@ -0,0 +1,254 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "envelopefile.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#define ENVELOPE_MAGIC "BTAONSET"
+#define ENVELOPE_VERSION 1
+// rows start aligned, so plain floats can be used in place
+#define ROW_ALIGN 16
+
+struct EnvelopeHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 flags;
+    float frameRate;
+    quint32 bands;
+    quint32 frames;
+    quint32 reserved;
+};
+
+struct EnvelopeBand
+{
+    quint32 offset;
+    quint32 size;
+    float scale;    // value of one quantisation step
+    quint32 reserved;
+};
+
+static int aligned(int size)
+{
+    return (size + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+}
+
+static void putVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.append((char)value);
+}
+
+static QByteArray encode(FloatSpan row, int flags, float *scale)
+{
+    QByteArray out;
+    if (!(flags & EnvelopeFile::QUANTIZED)) {
+        *scale = 1;
+        out.append((const char *)row.data(), row.size() * sizeof(float));
+        return out;
+    }
+
+    float peak = 0;
+    for (int i = 0; i < row.size(); i++)
+        peak = qMax(peak, row[i]);
+    *scale = peak > 0 ? peak / 65535.0f : 1;
+
+    int last = 0;
+    if (!(flags & EnvelopeFile::DELTA))
+        out.reserve(row.size() * sizeof(quint16));
+    for (int i = 0; i < row.size(); i++) {
+        int q = qBound(0, (int)lrintf(row[i] / *scale), 65535);
+        if (flags & EnvelopeFile::DELTA) {
+            int delta = q - last;
+            putVarint(out, (quint32)((delta << 1) ^ (delta >> 31)));
+            last = q;
+        } else {
+            quint16 value = q;
+            out.append((const char *)&value, sizeof(value));
+        }
+    }
+    return out;
+}
+
+static bool decode(const uchar *data, int size, int frames, int flags, float scale, float *row)
+{
+    if (!(flags & EnvelopeFile::DELTA)) {
+        if (size < frames * (int)sizeof(quint16))
+            return false;
+        const quint16 *values = (const quint16 *)data;
+        for (int i = 0; i < frames; i++)
+            row[i] = values[i] * scale;
+        return true;
+    }
+
+    const uchar *end = data + size;
+    int last = 0;
+    for (int i = 0; i < frames; i++) {
+        quint32 value = 0;
+        int shift = 0;
+        do {
+            if (data == end || shift > 28)
+                return false;
+            value |= (quint32)(*data & 0x7f) << shift;
+            shift += 7;
+        } while (*data++ & 0x80);
+        last += (int)(value >> 1) ^ -(int)(value & 1);
+        row[i] = last * scale;
+    }
+    return true;
+}
+
+EnvelopeFile::EnvelopeFile() :
+    m_map(0), m_flags(0), m_frames(0), m_frameRate(0)
+{
+    memset(m_bands, 0, sizeof(m_bands));
+}
+
+EnvelopeFile::~EnvelopeFile()
+{
+    close();
+}
+
+bool EnvelopeFile::write(const QString &fileName, const OnsetEnvelope &envelope, float frameRate, int flags)
+{
+    if (flags & DELTA)
+        flags |= QUANTIZED;
+
+    EnvelopeHeader header;
+    memcpy(header.magic, ENVELOPE_MAGIC, sizeof(header.magic));
+    header.version = ENVELOPE_VERSION;
+    header.flags = flags;
+    header.frameRate = frameRate;
+    header.bands = SpectralFlux::BAND_COUNT;
+    header.frames = envelope.frames();
+    header.reserved = 0;
+
+    EnvelopeBand table[SpectralFlux::BAND_COUNT];
+    QByteArray rows[SpectralFlux::BAND_COUNT];
+    int offset = aligned(sizeof(header) + sizeof(table));
+    for (int b = 0; b < SpectralFlux::BAND_COUNT; b++) {
+        rows[b] = encode(envelope.band(b), flags, &table[b].scale);
+        table[b].offset = offset;
+        table[b].size = rows[b].size();
+        table[b].reserved = 0;
+        offset = aligned(offset + rows[b].size());
+    }
+
+    // written as a whole or not at all
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << ": can not write" << fileName;
+        return false;
+    }
+    QByteArray block((const char *)&header, sizeof(header));
+    block.append((const char *)table, sizeof(table));
+    for (int b = 0; b < SpectralFlux::BAND_COUNT; b++) {
+        block.append(QByteArray(table[b].offset - block.size(), '\0'));
+        block.append(rows[b]);
+    }
+    file.write(block);
+    return file.commit();
+}
+
+bool EnvelopeFile::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < (qint64)sizeof(EnvelopeHeader)) {
+        qWarning() << Q_FUNC_INFO << ": can not read" << fileName;
+        close();
+        return false;
+    }
+
+    m_map = m_file.map(0, m_file.size());
+    if (!m_map) {
+        close();
+        return false;
+    }
+
+    const EnvelopeHeader *header = (const EnvelopeHeader *)m_map;
+    const EnvelopeBand *table = (const EnvelopeBand *)(m_map + sizeof(EnvelopeHeader));
+    qint64 size = m_file.size();
+    if (memcmp(header->magic, ENVELOPE_MAGIC, sizeof(header->magic)) != 0
+            || header->version != ENVELOPE_VERSION
+            || header->bands != SpectralFlux::BAND_COUNT
+            || size < (qint64)(sizeof(EnvelopeHeader) + sizeof(EnvelopeBand) * SpectralFlux::BAND_COUNT)
+            // every encoding takes at least a byte per frame and band
+            || header->frames > (quint32)(INT_MAX / SpectralFlux::BAND_COUNT)
+            || (qint64)header->frames * SpectralFlux::BAND_COUNT > size
+            || !qIsFinite(header->frameRate) || header->frameRate <= 0) {
+        qWarning() << Q_FUNC_INFO << ":" << fileName << "is no onset envelope of this version";
+        close();
+        return false;
+    }
+
+    m_flags = header->flags;
+    m_frames = header->frames;
+    m_frameRate = header->frameRate;
+    if (m_flags & QUANTIZED)
+        m_decoded.resize(m_frames * SpectralFlux::BAND_COUNT);
+
+    for (int b = 0; b < SpectralFlux::BAND_COUNT; b++) {
+        if ((qint64)table[b].offset + table[b].size > size) {
+            close();
+            return false;
+        }
+        const uchar *row = m_map + table[b].offset;
+        if (!(m_flags & QUANTIZED)) {
+            if (table[b].size < m_frames * sizeof(float)) {
+                close();
+                return false;
+            }
+            m_bands[b] = (const float *)row;
+            continue;
+        }
+        float *decoded = m_decoded.data() + b * m_frames;
+        if (!decode(row, table[b].size, m_frames, m_flags, table[b].scale, decoded)) {
+            qWarning() << Q_FUNC_INFO << ":" << fileName << "is truncated";
+            close();
+            return false;
+        }
+        m_bands[b] = decoded;
+    }
+    return true;
+}
+
+void EnvelopeFile::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = 0;
+    m_file.close();
+    m_flags = 0;
+    m_frames = 0;
+    m_frameRate = 0;
+    memset(m_bands, 0, sizeof(m_bands));
+    m_decoded.clear();
+}
+
+FloatSpan EnvelopeFile::band(int band) const
+{
+    if (band < 0 || band >= SpectralFlux::BAND_COUNT || !m_bands[band])
+        return FloatSpan();
+    return FloatSpan(m_bands[band], m_frames);
+}
@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ENVELOPEFILE_H
+#define ENVELOPEFILE_H
+
+#include <QtCore>
+
+#include "onsetenvelope.h"
+
+// Onset envelopes of a track on disk, so tempo and beat detection can run
+// again without decoding. A header with the frame rate and a table of
+// the bands is followed by one row per band, either plain floats which are
+// used straight from the mapped file, or 16 bit values scaled to the peak
+// of the band, optionally as zigzag varint deltas, which are decoded once.
+class EnvelopeFile
+{
+public:
+    enum flagType { QUANTIZED = 1, DELTA = 2 };
+
+    EnvelopeFile();
+    ~EnvelopeFile();
+
+    // DELTA implies QUANTIZED
+    static bool write(const QString &fileName, const OnsetEnvelope &envelope, float frameRate, int flags = 0);
+
+    bool open(const QString &fileName);
+    void close();
+
+    bool isOpen() const {return m_map != 0;}
+    int flags() const {return m_flags;}
+    int frames() const {return m_frames;}
+    float frameRate() const {return m_frameRate;}
+    // valid until the file is closed
+    FloatSpan band(int band) const;
+
+private:
+    QFile m_file;
+    uchar *m_map;
+    int m_flags;
+    int m_frames;
+    float m_frameRate;
+    const float *m_bands[SpectralFlux::BAND_COUNT];
+    QVector<float> m_decoded;
+
+    Q_DISABLE_COPY(EnvelopeFile)
+};
+
+#endif // ENVELOPEFILE_H
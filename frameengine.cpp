@@ -0,0 +1,49 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frameengine.h"
+
+// fft size, reference hop at 44100 Hz, analysed bins, window
+typedef FrameEngineImpl<128, 512, 64, GST_FFT_WINDOW_HAMMING> FastEngine;
+typedef FrameEngineImpl<512, 512, 256, GST_FFT_WINDOW_HAMMING> StandardEngine;
+typedef FrameEngineImpl<1024, 256, 512, GST_FFT_WINDOW_HANN> PreciseEngine;
+
+FrameEngine* FrameEngine::create(presetType preset)
+{
+    switch (preset) {
+    case STANDARD:
+        return new StandardEngine;
+    case PRECISE:
+        return new PreciseEngine;
+    case FAST:
+    default:
+        return new FastEngine;
+    }
+}
+
+const char* FrameEngine::presetName(presetType preset)
+{
+    switch (preset) {
+    case STANDARD:
+        return "standard";
+    case PRECISE:
+        return "precise";
+    case FAST:
+    default:
+        return "fast";
+    }
+}
@@ -0,0 +1,144 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef FRAMEENGINE_H
+#define FRAMEENGINE_H
+
+#include <gst/fft/gstfftf32.h>
+#include <string.h>
+
+#include "spectralflux.h"
+#include "analysisstats.h"
+
+#define REFERENCE_RATE 44100
+
+// drum bands in Hz, at 44100 Hz with the FAST preset these are the bins 0-3, 11-14 and 21-63
+#define BD_LOW 0
+#define BD_HIGH 1200
+#define SD_LOW 3700
+#define SD_HIGH 5000
+#define HH_LOW 7000
+
+// Turns mono samples into one spectral flux value per band and frame.
+// The geometry is fixed per specialisation, see FrameEngineImpl and the presets.
+class FrameEngine
+{
+public:
+    // FAST is the historic analyser: 128 point fft every 512 samples
+    enum presetType { FAST, STANDARD, PRECISE };
+
+    FrameEngine() : m_hop(0), m_frameRate(0), m_stats(0) {}
+    virtual ~FrameEngine() {}
+
+    static FrameEngine* create(presetType preset);
+    static const char* presetName(presetType preset);
+
+    virtual int fftSize() const = 0;
+    virtual int bands() const = 0;
+
+    // hop in samples at the given rate, the reference hop scaled from 44100 Hz
+    int hop() const {return m_hop;}
+    // frames per second of the onset envelope
+    float frameRate() const {return m_frameRate;}
+
+    // sets hop and drum bands for the sample rate
+    virtual void configure(int rate) = 0;
+    // forgets the spectrum of the last frame
+    virtual void reset() = 0;
+    // samples holds fftSize() mono samples starting at the frame, flux gets a value per band
+    virtual void process(const float *samples, float *flux) = 0;
+
+    // times fft and flux of every frame into stats, 0 turns it off
+    void setStats(AnalysisStats *stats) {m_stats = stats;}
+
+protected:
+    int m_hop;
+    float m_frameRate;
+    AnalysisStats *m_stats;
+};
+
+template <int FFT_SIZE, int HOP, int BANDS, GstFFTWindow WINDOW>
+class FrameEngineImpl : public FrameEngine
+{
+public:
+    FrameEngineImpl() :
+        m_flux(BANDS)
+    {
+        m_fft = gst_fft_f32_new (FFT_SIZE, FALSE);
+        configure(REFERENCE_RATE);
+        reset();
+    }
+
+    ~FrameEngineImpl()
+    {
+        gst_fft_f32_free (m_fft);
+    }
+
+    int fftSize() const {return FFT_SIZE;}
+    int bands() const {return BANDS;}
+
+    void configure(int rate)
+    {
+        m_hop = (HOP * rate + REFERENCE_RATE / 2) / REFERENCE_RATE;
+        if (m_hop < 1)
+            m_hop = 1;
+        m_frameRate = (float)rate / m_hop;
+
+        // drum bands by frequency, what is above nyquist stays empty
+        float binWidth = (float)rate / FFT_SIZE;
+        int bd = -1, sdFirst = BANDS, sdLast = -1, hh = BANDS;
+        for (int i = 0; i < BANDS; i++) {
+            float freq = i * binWidth;
+            if (freq >= BD_LOW && freq < BD_HIGH) bd = i;
+            if (freq >= SD_LOW && freq < SD_HIGH) { if (i < sdFirst) sdFirst = i; sdLast = i; }
+            if (freq >= HH_LOW && i < hh) hh = i;
+        }
+        m_flux.setBand(SpectralFlux::BD, 0, bd);
+        m_flux.setBand(SpectralFlux::SD, sdFirst, sdLast);
+        m_flux.setBand(SpectralFlux::HH, hh, BANDS - 1);
+    }
+
+    void reset()
+    {
+        memset(m_last, 0, sizeof(m_last));
+    }
+
+    void process(const float *samples, float *flux)
+    {
+        qint64 start = m_stats ? AnalysisStats::now() : 0;
+        memcpy(m_frame, samples, sizeof(m_frame));
+        gst_fft_f32_window (m_fft, m_frame, WINDOW);
+        gst_fft_f32_fft (m_fft, m_frame, m_freqdata);
+        qint64 transformed = m_stats ? AnalysisStats::now() : 0;
+        m_flux.process((const float*)m_freqdata, m_last, flux);
+        if (m_stats) {
+            m_stats->ns[AnalysisStats::FFT] += transformed - start;
+            m_stats->ns[AnalysisStats::FLUX] += AnalysisStats::now() - transformed;
+        }
+    }
+
+private:
+    static_assert(BANDS <= FFT_SIZE / 2, "more bands than fft bins");
+    static_assert(FFT_SIZE % 2 == 0, "the real fft needs an even size");
+
+    GstFFTF32 *m_fft;
+    SpectralFlux m_flux;
+    float m_frame[FFT_SIZE];
+    float m_last[BANDS];
+    GstFFTF32Complex m_freqdata[FFT_SIZE / 2 + 1];
+};
+
+#endif // FRAMEENGINE_H
@@ -0,0 +1,199 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "loudnessmeter.h"
+
+#include <math.h>
+
+// 100 ms steps, four of them make a block
+#define STEP_MS 100
+#define BLOCK_STEPS 4
+#define ABSOLUTE_GATE -70.0
+#define RELATIVE_GATE -10.0
+
+static inline double blockLoudness(double meanSquare)
+{
+    return -0.691 + 10 * log10(meanSquare);
+}
+
+LoudnessMeter::LoudnessMeter() :
+    m_rate(0), m_channels(0), m_stepFrames(0), m_silenceDB(-25.0f), m_sourceChannels(0)
+{
+    clear();
+}
+
+void LoudnessMeter::setup(int rate, int channels)
+{
+    m_rate = rate;
+    m_channels = channels;
+    m_stepFrames = qMax(1, rate * STEP_MS / 1000);
+
+    // the two K-weighting filters of BS.1770 for any sample rate
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    m_shelf.b1 = 2.0 * (k * k - vh) / a0;
+    m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    m_shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+    m_highpass.b0 = 1.0;
+    m_highpass.b1 = -2.0;
+    m_highpass.b2 = 1.0;
+    m_highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_highpass.a2 = (1.0 - k / q + k * k) / a0;
+
+    clear();
+}
+
+void LoudnessMeter::clear()
+{
+    m_state.fill(0.0, m_channels * 4);
+    m_stepFill = 0;
+    m_weighted = 0;
+    m_level = 0;
+    for ( int i = 0; i < BLOCK_STEPS; i++ )
+        m_steps[i] = 0;
+    m_stepCount = 0;
+    m_firstSound = -1;
+    m_lastSound = -1;
+    m_blocks.clear();
+}
+
+void LoudnessMeter::process(const float *data, int frames)
+{
+    if ( m_channels <= 0 || m_stepFrames <= 0 )
+        return;
+
+    const Biquad s = m_shelf;
+    const Biquad h = m_highpass;
+    double *state = m_state.data();
+    double silence = pow(10.0, m_silenceDB / 10.0) * m_stepFrames * m_channels;
+    // a correlated stereo source mixed to mono has half the summed power of its channels
+    double weight = m_sourceChannels > 0 ? (double)m_sourceChannels / m_channels : 1.0;
+
+    int i = 0;
+    while ( i < frames ) {
+        int n = qMin(frames - i, m_stepFrames - m_stepFill);
+        const float *in = data + i * m_channels;
+        for ( int c = 0; c < m_channels; c++ ) {
+            // transposed direct form II, the states stay in registers for the run
+            double s1 = state[c * 4], s2 = state[c * 4 + 1];
+            double h1 = state[c * 4 + 2], h2 = state[c * 4 + 3];
+            double weighted = 0, level = 0;
+            for ( int f = 0; f < n; f++ ) {
+                double x = in[f * m_channels + c];
+                double y = s.b0 * x + s1;
+                s1 = s.b1 * x - s.a1 * y + s2;
+                s2 = s.b2 * x - s.a2 * y;
+                double z = h.b0 * y + h1;
+                h1 = h.b1 * y - h.a1 * z + h2;
+                h2 = h.b2 * y - h.a2 * z;
+                weighted += z * z;
+                level += x * x;
+            }
+            state[c * 4] = s1; state[c * 4 + 1] = s2;
+            state[c * 4 + 2] = h1; state[c * 4 + 3] = h2;
+            m_weighted += weighted;
+            m_level += level;
+        }
+        m_stepFill += n;
+        i += n;
+
+        if ( m_stepFill == m_stepFrames ) {
+            // channels add up, as left and right do in BS.1770
+            m_steps[m_stepCount % BLOCK_STEPS] = weight * m_weighted / m_stepFrames;
+            if ( m_level > silence ) {
+                if ( m_firstSound < 0 )
+                    m_firstSound = m_stepCount * m_stepFrames;
+                m_lastSound = ( m_stepCount + 1 ) * m_stepFrames;
+            }
+            m_stepCount++;
+            if ( m_stepCount >= BLOCK_STEPS )
+                m_blocks.append((m_steps[0] + m_steps[1] + m_steps[2] + m_steps[3]) / BLOCK_STEPS);
+            m_stepFill = 0;
+            m_weighted = 0;
+            m_level = 0;
+        }
+    }
+}
+
+void LoudnessMeter::merge(const LoudnessMeter &other, qint64 offset, qint64 first, qint64 last)
+{
+    if ( other.m_stepFrames <= 0 )
+        return;
+    // a meter kept from another track may still measure at its rate
+    if ( m_rate != other.m_rate || m_channels != other.m_channels )
+        setup(other.m_rate, other.m_channels);
+
+    // block i of other starts with its step i
+    for ( int i = 0; i < other.m_blocks.size(); i++ ) {
+        qint64 start = (qint64)i * other.m_stepFrames;
+        if ( start >= first && start < last )
+            m_blocks.append(other.m_blocks[i]);
+    }
+
+    // the same samples are just as loud in any part, so no range here
+    if ( other.m_firstSound >= 0 ) {
+        if ( m_firstSound < 0 || other.m_firstSound + offset < m_firstSound )
+            m_firstSound = other.m_firstSound + offset;
+        m_lastSound = qMax(m_lastSound, other.m_lastSound + offset);
+    }
+}
+
+double LoudnessMeter::loudness() const
+{
+    double sum = 0;
+    int count = 0;
+    double gate = pow(10.0, (ABSOLUTE_GATE + 0.691) / 10.0);
+    for ( int i = 0; i < m_blocks.size(); i++ )
+        if ( m_blocks[i] > gate ) { sum += m_blocks[i]; count++; }
+    if ( count == 0 )
+        return ABSOLUTE_GATE - 1;
+
+    double relative = sum / count * pow(10.0, RELATIVE_GATE / 10.0);
+    sum = 0;
+    count = 0;
+    for ( int i = 0; i < m_blocks.size(); i++ )
+        if ( m_blocks[i] > gate && m_blocks[i] > relative ) { sum += m_blocks[i]; count++; }
+    return blockLoudness(sum / count);
+}
+
+double LoudnessMeter::gainDB(double invalid) const
+{
+    double lufs = loudness();
+    return lufs < ABSOLUTE_GATE ? invalid : REFERENCE_LUFS - lufs;
+}
+
+qint64 LoudnessMeter::soundStartMs() const
+{
+    return m_firstSound < 0 ? 0 : m_firstSound * 1000 / m_rate;
+}
+
+qint64 LoudnessMeter::soundEndMs() const
+{
+    return m_lastSound < 0 ? 0 : m_lastSound * 1000 / m_rate;
+}
@@ -0,0 +1,86 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <QVector>
+
+// Loudness and silence of interleaved samples in a single pass, instead of
+// the rganalysis and cutter elements. The loudness is the gated integrated
+// loudness of EBU R128 / ITU-R BS.1770: K-weighted mean squares of 400 ms
+// blocks overlapping by 75 %, an absolute gate at -70 LUFS and a relative
+// one 10 LU below. The gain brings it to the -18 LUFS of ReplayGain 2.0.
+// Sound starts with the first 100 ms step above the silence threshold and
+// ends with the last one.
+class LoudnessMeter
+{
+public:
+    LoudnessMeter();
+
+    void setup(int rate, int channels);
+    int rate() const {return m_rate;}
+    int channels() const {return m_channels;}
+    // dBFS of the unweighted level below which a step counts as silent
+    void setSilenceThreshold(float dB) {m_silenceDB = dB;}
+    // channels of the source the samples were mixed from: BS.1770 sums the power of
+    // every source channel, a mix to fewer channels counts each one as if it carried it
+    void setSourceChannels(int channels) {m_sourceChannels = channels;}
+    void clear();
+
+    void process(const float *data, int frames);
+    // the blocks of other starting within its samples first..last, and its
+    // sound; other began offset samples into the time line of this meter
+    void merge(const LoudnessMeter &other, qint64 offset, qint64 first, qint64 last);
+
+    // integrated loudness in LUFS, below -70 when everything was gated
+    double loudness() const;
+    // dB to the reference level, invalid when nothing passed the gates
+    double gainDB(double invalid) const;
+    bool hasSound() const {return m_firstSound >= 0;}
+    // milliseconds from the first processed sample
+    qint64 soundStartMs() const;
+    qint64 soundEndMs() const;
+
+    static const int REFERENCE_LUFS = -18;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    int m_rate;
+    int m_channels;
+    int m_stepFrames;
+    float m_silenceDB;
+    int m_sourceChannels;
+    Biquad m_shelf;
+    Biquad m_highpass;
+    // two stages of two states per channel
+    QVector<double> m_state;
+    int m_stepFill;
+    double m_weighted;
+    double m_level;
+    double m_steps[4];
+    qint64 m_stepCount;
+    // samples where the first loud step starts and the last one ends
+    qint64 m_firstSound;
+    qint64 m_lastSound;
+    // mean squares of all blocks, the relative gate needs them all
+    QVector<double> m_blocks;
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,113 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "octaveresolver.h"
+
+#include <QDebug>
+#include <math.h>
+
+// each pulse covers its lag and both neighbours
+#define PULSE_WIDTH 3
+#define TAPS (OctaveResolver::PULSES * PULSE_WIDTH)
+// center and width in octaves of the tempo preference
+#define PREFERRED_BPM 120.0f
+#define PREFERENCE_OCTAVES 1.0f
+
+OctaveResolver::OctaveResolver() :
+    m_frameRate(0), m_minLag(0), m_maxLag(0), m_confidence(0)
+{
+    for (int l = 0; l < LEVELS; l++)
+        m_scores[l] = 0;
+}
+
+void OctaveResolver::setup(float frameRate, int minBpm, int maxBpm)
+{
+    int maxLag = frameRate * 60 / minBpm;
+    int minLag = frameRate * 60 / maxBpm;
+    if ( frameRate == m_frameRate && minLag == m_minLag && maxLag == m_maxLag )
+        return;
+
+    m_frameRate = frameRate;
+    m_minLag = qMax(1, minLag);
+    m_maxLag = maxLag;
+
+    // later pulses weigh less, a slower level must not win on its own harmonics
+    const float shape[PULSE_WIDTH] = { 0.5f, 1.0f, 0.5f };
+    int rows = qMax(0, m_maxLag - m_minLag);
+    m_taps.resize(rows * TAPS);
+    m_weights.resize(rows * TAPS);
+    m_response.resize(rows);
+    for (int r = 0; r < rows; r++) {
+        int lag = m_minLag + r;
+        float total = 0;
+        for (int k = 0; k < PULSES; k++)
+            for (int d = 0; d < PULSE_WIDTH; d++) {
+                int tap = r * TAPS + k * PULSE_WIDTH + d;
+                m_taps[tap] = (k + 1) * lag + d - PULSE_WIDTH / 2;
+                m_weights[tap] = shape[d] / (k + 1);
+                total += m_weights[tap];
+            }
+        for (int t = 0; t < TAPS; t++)
+            m_weights[r * TAPS + t] /= total;
+    }
+}
+
+float OctaveResolver::resolve(const float *xcorr, int size, float bpm)
+{
+    m_confidence = 0;
+    for (int l = 0; l < LEVELS; l++)
+        m_scores[l] = 0;
+    int rows = m_response.count();
+    if ( bpm <= 0 || rows == 0 || size <= PULSES * m_maxLag )
+        return bpm;
+
+    // the whole bank at once: a dot product of every row with the correlation
+    const int *taps = m_taps.constData();
+    const float *weights = m_weights.constData();
+    float *response = m_response.data();
+    for (int r = 0; r < rows; r++) {
+        float sum = 0;
+        for (int t = 0; t < TAPS; t++)
+            sum += weights[r * TAPS + t] * xcorr[taps[r * TAPS + t]];
+        response[r] = sum;
+    }
+
+    // half, the same and double tempo, as long as they are in the range
+    const float factors[LEVELS] = { 0.5f, 1.0f, 2.0f };
+    int best = 1;
+    for (int l = 0; l < LEVELS; l++) {
+        float candidate = bpm * factors[l];
+        int row = qRound(60.0f * m_frameRate / candidate) - m_minLag;
+        if ( row < 0 || row >= rows )
+            continue;
+        float octaves = log2f(candidate / PREFERRED_BPM) / PREFERENCE_OCTAVES;
+        m_scores[l] = response[row] * expf(-0.5f * octaves * octaves);
+        if ( m_scores[l] > m_scores[best] )
+            best = l;
+    }
+
+    float second = 0;
+    for (int l = 0; l < LEVELS; l++)
+        if ( l != best && m_scores[l] > second )
+            second = m_scores[l];
+    if ( m_scores[best] > 0 )
+        m_confidence = (m_scores[best] - second) / m_scores[best];
+
+    qDebug() << Q_FUNC_INFO << "half:" << m_scores[0] << "same:" << m_scores[1] << "double:" << m_scores[2]
+             << "confidence:" << m_confidence;
+    return bpm * factors[best];
+}
@@ -0,0 +1,57 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef OCTAVERESOLVER_H
+#define OCTAVERESOLVER_H
+
+#include <QVector>
+
+// Picks the metrical level of a tempo: half, the same or double. Every lag
+// of the tempo range has a comb template with pulses at its first
+// harmonics, a little wider than one lag. The bank of templates is built
+// once per frame rate and applied to the autocorrelation of the onsets in
+// one pass; the score of a level is its comb response times a broad
+// preference for tempi around 120 bpm.
+class OctaveResolver
+{
+public:
+    enum { PULSES = 4, LEVELS = 3 };
+
+    OctaveResolver();
+
+    void setup(float frameRate, int minBpm = 60, int maxBpm = 200);
+    // xcorr must hold PULSES times the longest tempo lag, like BandTempo::lags()
+    float resolve(const float *xcorr, int size, float bpm);
+
+    float confidence() const {return m_confidence;}
+    // score of half, the same and double tempo of the last resolve
+    const float* scores() const {return m_scores;}
+
+private:
+    float m_frameRate;
+    int m_minLag;
+    int m_maxLag;
+
+    // per lag of the tempo range a row of taps into the autocorrelation
+    QVector<int> m_taps;
+    QVector<float> m_weights;
+    QVector<float> m_response;
+
+    float m_scores[LEVELS];
+    float m_confidence;
+};
+
+#endif // OCTAVERESOLVER_H
@@ -0,0 +1,110 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "onlinetempo.h"
+
+#include <string.h>
+
+OnlineTempo::OnlineTempo() :
+    m_frameRate(0), m_minLag(0), m_maxLag(0)
+    , m_peaks(0), m_xcorr(0)
+{
+    reset();
+}
+
+OnlineTempo::~OnlineTempo()
+{
+    delete[] m_peaks;
+    delete[] m_xcorr;
+}
+
+void OnlineTempo::setup(float frameRate, int minBpm, int maxBpm)
+{
+    int maxLag = frameRate * 60 / minBpm;
+    if (frameRate != m_frameRate || maxLag != m_maxLag) {
+        delete[] m_peaks;
+        delete[] m_xcorr;
+        m_peaks = new float[maxLag + 1];
+        m_xcorr = new double[maxLag + 1];
+    }
+    m_frameRate = frameRate;
+    m_maxLag = maxLag;
+    m_minLag = frameRate * 60 / maxBpm;
+    reset();
+}
+
+void OnlineTempo::reset()
+{
+    m_threshold.reset();
+    m_peakCount = 0;
+    m_bpm = 0;
+    m_confidence = 0;
+    if (m_xcorr) {
+        memset(m_peaks, 0, (m_maxLag + 1) * sizeof(float));
+        memset(m_xcorr, 0, (m_maxLag + 1) * sizeof(double));
+    }
+}
+
+void OnlineTempo::push(float flux)
+{
+    if (!m_xcorr)
+        return;
+
+    // the threshold is centered, so peaks come a few frames late
+    float peak;
+    if (m_threshold.push(flux, &peak))
+        addPeak(peak);
+}
+
+void OnlineTempo::addPeak(float peak)
+{
+    int size = m_maxLag + 1;
+    int k = m_peakCount++;
+
+    // most frames are no peak and add nothing
+    if (peak != 0) {
+        for (int lag = m_minLag; lag < m_maxLag && lag <= k; lag++)
+            m_xcorr[lag] += peak * m_peaks[(k - lag) % size];
+    }
+    m_peaks[k % size] = peak;
+}
+
+void OnlineTempo::estimate()
+{
+    double maxCorr = 0;
+    double sum = 0;
+    int optiLag = 0;
+
+    for (int lag = m_minLag; lag < m_maxLag; lag++) {
+        sum += m_xcorr[lag];
+        if (m_xcorr[lag] > maxCorr) {
+            maxCorr = m_xcorr[lag];
+            optiLag = lag;
+        }
+    }
+
+    if (optiLag == 0) {
+        m_bpm = 0;
+        m_confidence = 0;
+        return;
+    }
+
+    // how far the best lag stands out of the average correlation
+    double mean = sum / (m_maxLag - m_minLag);
+    m_bpm = 60.0 * m_frameRate / optiLag;
+    m_confidence = (maxCorr - mean) / maxCorr;
+}
@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ONLINETEMPO_H
+#define ONLINETEMPO_H
+
+#include "onsetthreshold.h"
+
+// Running tempo estimate while the track is decoded: every new flux value
+// goes through the same threshold and peak picking as detectTempo and
+// updates the autocorrelation of the peaks for all tempo lags at once.
+class OnlineTempo
+{
+public:
+    OnlineTempo();
+    ~OnlineTempo();
+
+    void setup(float frameRate, int minBpm = 60, int maxBpm = 200);
+    void reset();
+
+    void push(float flux);
+
+    int frames() const {return m_threshold.frames();}
+    float bpm() const {return m_bpm;}
+    float confidence() const {return m_confidence;}
+
+    // picks the best lag of the correlation so far, cost is one pass over the lags
+    void estimate();
+
+private:
+    float m_frameRate;
+    int m_minLag;
+    int m_maxLag;
+
+    OnsetThreshold m_threshold;
+    float *m_peaks;
+    int m_peakCount;
+    double *m_xcorr;
+
+    float m_bpm;
+    float m_confidence;
+
+    void addPeak(float peak);
+
+    OnlineTempo(const OnlineTempo&);
+    OnlineTempo& operator=(const OnlineTempo&);
+};
+
+#endif // ONLINETEMPO_H
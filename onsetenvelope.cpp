@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "onsetenvelope.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+OnsetEnvelope::OnsetEnvelope() :
+    m_data(0), m_frames(0), m_peaks(0), m_capacity(0)
+    , m_xcorr(0), m_xcorrCapacity(0)
+{
+}
+
+OnsetEnvelope::~OnsetEnvelope()
+{
+    free(m_data);
+    free(m_xcorr);
+}
+
+void OnsetEnvelope::reserve(int frames)
+{
+    if (frames <= m_capacity)
+        return;
+
+    // rows move apart, so copy each one into the new block
+    float *data = (float*)malloc((size_t)ROWS * frames * sizeof(float));
+    if (m_data) {
+        for (int row = 0; row < ROWS; row++)
+            memcpy(data + (size_t)row * frames, m_data + (size_t)row * m_capacity, m_capacity * sizeof(float));
+        free(m_data);
+    }
+    m_data = data;
+    m_capacity = frames;
+}
+
+void OnsetEnvelope::clear()
+{
+    m_frames = 0;
+    m_peaks = 0;
+}
+
+float* OnsetEnvelope::xcorr(int lags)
+{
+    if (lags > m_xcorrCapacity) {
+        free(m_xcorr);
+        m_xcorr = (float*)malloc(lags * sizeof(float));
+        m_xcorrCapacity = lags;
+    }
+    memset(m_xcorr, 0, lags * sizeof(float));
+    return m_xcorr;
+}
@@ -0,0 +1,92 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ONSETENVELOPE_H
+#define ONSETENVELOPE_H
+
+#include "spectralflux.h"
+
+// Read-only view on contiguous floats, valid until the owner changes
+class FloatSpan
+{
+public:
+    FloatSpan() : m_data(0), m_size(0) {}
+    FloatSpan(const float *data, int size) : m_data(data), m_size(size) {}
+
+    const float* data() const {return m_data;}
+    int size() const {return m_size;}
+    int count() const {return m_size;}
+    bool isEmpty() const {return m_size == 0;}
+    float at(int i) const {return m_data[i];}
+    float operator[](int i) const {return m_data[i];}
+    const float* begin() const {return m_data;}
+    const float* end() const {return m_data + m_size;}
+
+private:
+    const float *m_data;
+    int m_size;
+};
+
+// Per analysis storage of the onset envelopes as structure of arrays:
+// one block holds a row per flux band and the peaks, so a track costs one
+// allocation when it is sized up front. The correlation scratch is kept
+// next to it and only ever grows.
+class OnsetEnvelope
+{
+public:
+    OnsetEnvelope();
+    ~OnsetEnvelope();
+
+    void reserve(int frames);
+    void clear();
+
+    // one flux value per SpectralFlux band
+    inline void append(const float *flux)
+    {
+        if (m_frames == m_capacity)
+            reserve(m_capacity < 1024 ? 1024 : m_capacity * 2);
+        for (int b = 0; b < SpectralFlux::BAND_COUNT; b++)
+            m_data[b * m_capacity + m_frames] = flux[b];
+        m_frames++;
+    }
+
+    int frames() const {return m_frames;}
+    int capacity() const {return m_capacity;}
+    FloatSpan band(int band) const {return FloatSpan(m_data + band * m_capacity, m_frames);}
+
+    // peaks has room for frames() values
+    float* peaksData() {return m_data + PEAKS * m_capacity;}
+    void setPeakCount(int count) {m_peaks = count;}
+    FloatSpan peaks() const {return FloatSpan(m_data + PEAKS * m_capacity, m_peaks);}
+
+    // zeroed scratch of at least lags values, reused between calls
+    float* xcorr(int lags);
+
+private:
+    enum { PEAKS = SpectralFlux::BAND_COUNT, ROWS };
+
+    float *m_data;
+    int m_frames;
+    int m_peaks;
+    int m_capacity;
+    float *m_xcorr;
+    int m_xcorrCapacity;
+
+    OnsetEnvelope(const OnsetEnvelope&);
+    OnsetEnvelope& operator=(const OnsetEnvelope&);
+};
+
+#endif // ONSETENVELOPE_H
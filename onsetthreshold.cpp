@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "onsetthreshold.h"
+
+#include <algorithm>
+#include <string.h>
+
+OnsetThreshold::OnsetThreshold(int window, float multiplier, bool median) :
+    m_window(window < 1 ? 1 : window), m_multiplier(multiplier), m_median(median)
+{
+    m_ring = new float[2 * m_window + 1];
+    m_sorted = new float[2 * m_window + 1];
+    reset();
+}
+
+OnsetThreshold::~OnsetThreshold()
+{
+    delete[] m_ring;
+    delete[] m_sorted;
+}
+
+void OnsetThreshold::reset()
+{
+    m_sortedCount = 0;
+    m_sum = 0;
+    m_pushed = 0;
+    m_windowStart = 0;
+    m_center = 0;
+    m_lastPruned = 0;
+    m_peakCount = 0;
+}
+
+void OnsetThreshold::add(float value)
+{
+    m_sum += value;
+    if (m_median) {
+        float *pos = std::upper_bound(m_sorted, m_sorted + m_sortedCount, value);
+        memmove(pos + 1, pos, (m_sorted + m_sortedCount - pos) * sizeof(float));
+        *pos = value;
+        m_sortedCount++;
+    }
+}
+
+void OnsetThreshold::remove(float value)
+{
+    m_sum -= value;
+    if (m_median) {
+        float *pos = std::lower_bound(m_sorted, m_sorted + m_sortedCount, value);
+        memmove(pos, pos + 1, (m_sorted + m_sortedCount - pos - 1) * sizeof(float));
+        m_sortedCount--;
+    }
+}
+
+// threshold of frame m_center with the window ending at end, peak of the frame before
+int OnsetThreshold::prune(int end, float *peak)
+{
+    int size = 2 * m_window + 1;
+    int start = m_center - m_window > 0 ? m_center - m_window : 0;
+    while (m_windowStart < start)
+        remove(m_ring[m_windowStart++ % size]);
+
+    float value = m_ring[m_center % size];
+    float pruned = 0;
+    if (end > start) {
+        float level;
+        if (m_median)
+            level = m_sorted[m_sortedCount / 2];
+        else
+            level = m_sum / (end - start);
+        float threshold = level * m_multiplier;
+        if (threshold <= value)
+            pruned = value - threshold;
+    }
+
+    int found = 0;
+    if (m_center > 0) {
+        *peak = m_lastPruned > pruned ? m_lastPruned : 0;
+        if (*peak != 0)
+            m_peakCount++;
+        found = 1;
+    }
+    m_lastPruned = pruned;
+    m_center++;
+    return found;
+}
+
+int OnsetThreshold::push(float flux, float *peak)
+{
+    int size = 2 * m_window + 1;
+    int n = m_pushed++;
+
+    // the ring keeps the window of the oldest frame without threshold yet
+    if (n >= size && m_windowStart <= n - size)
+        remove(m_ring[m_windowStart++ % size]);
+    m_ring[n % size] = flux;
+    add(flux);
+
+    if (n - m_window < m_center)
+        return 0;
+    return prune(n, peak);
+}
+
+int OnsetThreshold::finish(float *peaks)
+{
+    // the window of the last frames ends at the last frame
+    int count = 0;
+    while (m_center < m_pushed)
+        count += prune(m_pushed - 1, peaks + count);
+    return count;
+}
+
+int OnsetThreshold::process(const float *onsets, int frames, float *peaks)
+{
+    reset();
+    int count = 0;
+    for (int i = 0; i < frames; i++)
+        count += push(onsets[i], peaks + count);
+    count += finish(peaks + count);
+    return count;
+}
@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ONSETTHRESHOLD_H
+#define ONSETTHRESHOLD_H
+
+// Adaptive threshold and peak picking of an onset envelope in one pass.
+// The threshold is the mean (or median) of a centered window times a
+// multiplier, so each peak is known window+1 frames after its flux value.
+// A peak is a pruned value above the one of the next frame, otherwise 0.
+class OnsetThreshold
+{
+public:
+    OnsetThreshold(int window = 10, float multiplier = 2.0f, bool median = false);
+    ~OnsetThreshold();
+
+    void reset();
+
+    // adds the next flux value, returns 1 and sets *peak once the peak of an older frame is known
+    int push(float flux, float *peak);
+    // end of the envelope: writes the peaks of the remaining frames, returns how many
+    int finish(float *peaks);
+
+    int frames() const {return m_pushed;}
+    int peakCount() const {return m_peakCount;}
+
+    // whole envelope at once, peaks gets frames-1 values and may be the onsets array itself
+    int process(const float *onsets, int frames, float *peaks);
+
+private:
+    int m_window;
+    float m_multiplier;
+    bool m_median;
+
+    float *m_ring;
+    float *m_sorted;
+    int m_sortedCount;
+    double m_sum;
+    int m_pushed;
+    int m_windowStart;
+    int m_center;
+    float m_lastPruned;
+    int m_peakCount;
+
+    void add(float value);
+    void remove(float value);
+    int prune(int end, float *peak);
+
+    OnsetThreshold(const OnsetThreshold&);
+    OnsetThreshold& operator=(const OnsetThreshold&);
+};
+
+#endif // ONSETTHRESHOLD_H
@@ -0,0 +1,419 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pcmfile.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define PCMFILE_X86
+ #include <immintrin.h>
+#endif
+
+typedef void (*ConvertKernel)(const uchar *in, int samples, float *out);
+
+static inline quint16 le16(const uchar *p) {return p[0] | (p[1] << 8);}
+static inline quint32 le32(const uchar *p) {return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);}
+static inline quint16 be16(const uchar *p) {return (p[0] << 8) | p[1];}
+static inline quint32 be32(const uchar *p) {return ((quint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];}
+
+static void s16le_scalar(const uchar *in, int samples, float *out)
+{
+    for (int i = 0; i < samples; i++)
+        out[i] = (qint16)le16(in + 2 * i) * (1.0f / 32768);
+}
+
+static void s32le_scalar(const uchar *in, int samples, float *out)
+{
+    for (int i = 0; i < samples; i++)
+        out[i] = (qint32)le32(in + 4 * i) * (1.0f / 2147483648.0f);
+}
+
+#ifdef PCMFILE_X86
+
+__attribute__((target("sse2")))
+static void s16le_sse2(const uchar *in, int samples, float *out)
+{
+    __m128 scale = _mm_set1_ps(1.0f / 32768);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+        // the samples into the upper halves, the arithmetic shift extends the sign
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    s16le_scalar(in + 2 * i, samples - i, out + i);
+}
+
+__attribute__((target("sse2")))
+static void s32le_sse2(const uchar *in, int samples, float *out)
+{
+    __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    int i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 4 * i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    s32le_scalar(in + 4 * i, samples - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static void s16le_avx2(const uchar *in, int samples, float *out)
+{
+    __m256 scale = _mm256_set1_ps(1.0f / 32768);
+    int i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + 2 * i + 16));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), scale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), scale));
+    }
+    s16le_scalar(in + 2 * i, samples - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static void s32le_avx2(const uchar *in, int samples, float *out)
+{
+    __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + 4 * i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    s32le_scalar(in + 4 * i, samples - i, out + i);
+}
+
+#endif // PCMFILE_X86
+
+struct Kernels
+{
+    ConvertKernel s16le;
+    ConvertKernel s32le;
+};
+
+static Kernels selectKernels()
+{
+    Kernels kernels = { s16le_scalar, s32le_scalar };
+#ifdef PCMFILE_X86
+    __builtin_cpu_init();
+    if (getenv("BEATANALYSIS_NO_SIMD"))
+        return kernels;
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.s16le = s16le_avx2;
+        kernels.s32le = s32le_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        kernels.s16le = s16le_sse2;
+        kernels.s32le = s32le_sse2;
+    }
+#endif
+    return kernels;
+}
+
+static const Kernels& kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+// the rest is rare enough for plain loops
+static void convert(const uchar *in, int samples, float *out, PcmFile::sampleType type, bool bigEndian)
+{
+    switch (type) {
+    case PcmFile::U8:
+        for (int i = 0; i < samples; i++)
+            out[i] = (in[i] - 128) * (1.0f / 128);
+        break;
+    case PcmFile::S8:
+        for (int i = 0; i < samples; i++)
+            out[i] = (qint8)in[i] * (1.0f / 128);
+        break;
+    case PcmFile::S16:
+        if (!bigEndian)
+            kernels().s16le(in, samples, out);
+        else for (int i = 0; i < samples; i++)
+            out[i] = (qint16)be16(in + 2 * i) * (1.0f / 32768);
+        break;
+    case PcmFile::S24:
+        for (int i = 0; i < samples; i++) {
+            const uchar *s = in + 3 * i;
+            quint32 v = bigEndian ? ((quint32)s[0] << 24) | (s[1] << 16) | (s[2] << 8)
+                                  : ((quint32)s[2] << 24) | (s[1] << 16) | (s[0] << 8);
+            out[i] = (qint32)v * (1.0f / 2147483648.0f);
+        }
+        break;
+    case PcmFile::S32:
+        if (!bigEndian)
+            kernels().s32le(in, samples, out);
+        else for (int i = 0; i < samples; i++)
+            out[i] = (qint32)be32(in + 4 * i) * (1.0f / 2147483648.0f);
+        break;
+    case PcmFile::F32:
+        for (int i = 0; i < samples; i++) {
+            quint32 v = bigEndian ? be32(in + 4 * i) : le32(in + 4 * i);
+            memcpy(out + i, &v, sizeof(float));
+        }
+        break;
+    case PcmFile::F64:
+        for (int i = 0; i < samples; i++) {
+            const uchar *s = in + 8 * i;
+            quint64 v = bigEndian ? ((quint64)be32(s) << 32) | be32(s + 4)
+                                  : ((quint64)le32(s + 4) << 32) | le32(s);
+            double d;
+            memcpy(&d, &v, sizeof(double));
+            out[i] = d;
+        }
+        break;
+    default:
+        memset(out, 0, samples * sizeof(float));
+        break;
+    }
+}
+
+PcmFile::PcmFile() :
+    m_data(0), m_samples(0), m_frames(0), m_rate(0), m_channels(0),
+    m_type(INVALID), m_bigEndian(false), m_frameBytes(0),
+    m_rawRate(44100), m_rawChannels(2), m_rawType(S16), m_rawBigEndian(false)
+{
+}
+
+PcmFile::~PcmFile()
+{
+    close();
+}
+
+bool PcmFile::isCandidate(const QString &fileName)
+{
+    static const QStringList suffixes = QStringList() << "wav" << "wave" << "aif" << "aiff" << "aifc" << "raw" << "pcm";
+    return suffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+PcmFile::sampleType PcmFile::typeFromName(const QString &name)
+{
+    static const char *names[] = { "", "u8", "s8", "s16", "s24", "s32", "f32", "f64" };
+    for (int t = U8; t <= F64; t++)
+        if (name == names[t])
+            return (sampleType)t;
+    return INVALID;
+}
+
+void PcmFile::setRawFormat(int rate, int channels, sampleType type, bool bigEndian)
+{
+    m_rawRate = rate;
+    m_rawChannels = channels;
+    m_rawType = type;
+    m_rawBigEndian = bigEndian;
+}
+
+bool PcmFile::setFormat(int rate, int channels, int bits, bool isFloat, bool isSigned, bool bigEndian)
+{
+    m_type = INVALID;
+    if (isFloat)
+        m_type = bits == 32 ? F32 : bits == 64 ? F64 : INVALID;
+    else if (bits == 8)
+        m_type = isSigned ? S8 : U8;
+    else if (bits == 16)
+        m_type = S16;
+    else if (bits == 24)
+        m_type = S24;
+    else if (bits == 32)
+        m_type = S32;
+
+    m_rate = rate;
+    m_channels = channels;
+    m_bigEndian = bigEndian;
+    m_frameBytes = channels * bits / 8;
+    return m_type != INVALID && rate > 0 && channels > 0;
+}
+
+bool PcmFile::parseWav(const uchar *data, qint64 size)
+{
+    bool haveFormat = false;
+    qint64 pos = 12;
+    while (pos + 8 <= size) {
+        const uchar *chunk = data + pos;
+        quint32 length = le32(chunk + 4);
+        const uchar *body = chunk + 8;
+        qint64 available = size - pos - 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && length >= 16 && available >= 16) {
+            int format = le16(body);
+            int channels = le16(body + 2);
+            int rate = le32(body + 4);
+            int bits = le16(body + 14);
+            // extensible: the format is the start of the sub format guid
+            if (format == 0xFFFE && length >= 40 && available >= 40)
+                format = le16(body + 24);
+            if (format != 1 && format != 3)
+                return false;
+            // 8 bit wav is unsigned, everything else signed
+            haveFormat = setFormat(rate, channels, bits, format == 3, bits != 8, false);
+            if (!haveFormat)
+                return false;
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+            // streamed files may leave the length open, the file ends the data then
+            qint64 bytes = qMin<qint64>(length, available);
+            m_samples = body;
+            m_frames = bytes / m_frameBytes;
+            return true;
+        }
+        pos += 8 + length + (length & 1);
+    }
+    return false;
+}
+
+// 80 bit extended precision of the sample rate
+static double extended(const uchar *p)
+{
+    int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    quint64 mantissa = ((quint64)be32(p + 2) << 32) | be32(p + 6);
+    if (exponent == 0 && mantissa == 0)
+        return 0;
+    double value = ldexp((double)mantissa, exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+bool PcmFile::parseAiff(const uchar *data, qint64 size)
+{
+    bool aifc = memcmp(data + 8, "AIFC", 4) == 0;
+    bool haveFormat = false;
+    qint64 pos = 12;
+    while (pos + 8 <= size) {
+        const uchar *chunk = data + pos;
+        quint32 length = be32(chunk + 4);
+        const uchar *body = chunk + 8;
+        qint64 available = size - pos - 8;
+
+        if (memcmp(chunk, "COMM", 4) == 0 && length >= 18 && available >= 18) {
+            int channels = be16(body);
+            int bits = be16(body + 6);
+            int rate = qRound(extended(body + 8));
+            bool isFloat = false;
+            bool bigEndian = true;
+            if (aifc && length >= 22 && available >= 22) {
+                const uchar *compression = body + 18;
+                if (memcmp(compression, "sowt", 4) == 0)
+                    bigEndian = false;
+                else if (memcmp(compression, "fl32", 4) == 0 || memcmp(compression, "FL32", 4) == 0)
+                    isFloat = true, bits = 32;
+                else if (memcmp(compression, "fl64", 4) == 0 || memcmp(compression, "FL64", 4) == 0)
+                    isFloat = true, bits = 64;
+                else if (memcmp(compression, "NONE", 4) != 0 && memcmp(compression, "twos", 4) != 0)
+                    return false;
+            }
+            // sample sizes round up to whole bytes
+            haveFormat = setFormat(rate, channels, (bits + 7) & ~7, isFloat, true, bigEndian);
+            if (!haveFormat)
+                return false;
+        }
+        else if (memcmp(chunk, "SSND", 4) == 0 && haveFormat && available >= 8) {
+            quint32 offset = be32(body);
+            qint64 bytes = qMin<qint64>(length, available) - 8 - offset;
+            if (bytes < 0)
+                return false;
+            m_samples = body + 8 + offset;
+            m_frames = bytes / m_frameBytes;
+            return true;
+        }
+        pos += 8 + length + (length & 1);
+    }
+    return false;
+}
+
+bool PcmFile::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+    qint64 size = m_file.size();
+    if (size < 12 || !(m_data = m_file.map(0, size))) {
+        close();
+        return false;
+    }
+
+    bool ok;
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (memcmp(m_data, "RIFF", 4) == 0 && memcmp(m_data + 8, "WAVE", 4) == 0)
+        ok = parseWav(m_data, size);
+    else if (memcmp(m_data, "FORM", 4) == 0 && (memcmp(m_data + 8, "AIFF", 4) == 0 || memcmp(m_data + 8, "AIFC", 4) == 0))
+        ok = parseAiff(m_data, size);
+    else if (suffix == "raw" || suffix == "pcm") {
+        int bits[] = { 0, 8, 8, 16, 24, 32, 32, 64 };
+        ok = setFormat(m_rawRate, m_rawChannels, bits[m_rawType], m_rawType >= F32, m_rawType != U8, m_rawBigEndian);
+        m_samples = m_data;
+        m_frames = ok ? size / m_frameBytes : 0;
+    }
+    else
+        ok = false;
+
+    if (!ok)
+        close();
+    return ok;
+}
+
+void PcmFile::close()
+{
+    if (m_data)
+        m_file.unmap((uchar *)m_data);
+    m_file.close();
+    m_data = 0;
+    m_samples = 0;
+    m_frames = 0;
+    m_rate = 0;
+    m_channels = 0;
+    m_type = INVALID;
+}
+
+int PcmFile::read(qint64 first, int count, float *out, int outChannels)
+{
+    if (!m_data || first >= m_frames)
+        return 0;
+    count = (int)qMin<qint64>(count, m_frames - first);
+    const uchar *in = m_samples + first * m_frameBytes;
+
+    if (outChannels == m_channels) {
+        convert(in, count * m_channels, out, m_type, m_bigEndian);
+        return count;
+    }
+
+    m_scratch.resize(count * m_channels);
+    convert(in, count * m_channels, m_scratch.data(), m_type, m_bigEndian);
+    mixChannels(m_scratch.constData(), m_channels, count, out, outChannels);
+    return count;
+}
+
+void PcmFile::mixChannels(const float *in, int inChannels, int frames, float *out, int outChannels)
+{
+    if (inChannels == outChannels)
+        memcpy(out, in, frames * outChannels * sizeof(float));
+    else if (inChannels == 1 && outChannels == 2) {
+        for (int i = 0; i < frames; i++)
+            out[2 * i] = out[2 * i + 1] = in[i];
+    }
+    else if (inChannels == 2 && outChannels == 1) {
+        for (int i = 0; i < frames; i++)
+            out[i] = (in[2 * i] + in[2 * i + 1]) / 2;
+    }
+    else
+        memset(out, 0, frames * outChannels * sizeof(float));
+}
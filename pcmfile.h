@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PCMFILE_H
+#define PCMFILE_H
+
+#include <QtCore>
+
+// Uncompressed audio straight from a memory mapped file: WAV (PCM, float
+// and extensible), AIFF and AIFF-C (none, sowt, fl32, fl64) and raw PCM
+// of a given format. Samples convert to floats of -1..1 as audioconvert
+// does, the 16 and 32 bit integer formats with SSE2 or AVX2.
+class PcmFile
+{
+public:
+    enum sampleType { INVALID, U8, S8, S16, S24, S32, F32, F64 };
+
+    PcmFile();
+    ~PcmFile();
+
+    // by the file name only, open() still may fail
+    static bool isCandidate(const QString &fileName);
+
+    // raw files have no header, 44100 Hz stereo 16 bit little endian by default
+    void setRawFormat(int rate, int channels, sampleType type, bool bigEndian = false);
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const {return m_data != 0;}
+
+    int rate() const {return m_rate;}
+    int channels() const {return m_channels;}
+    qint64 frames() const {return m_frames;}
+    sampleType type() const {return m_type;}
+    int frameBytes() const {return m_frameBytes;}
+
+    // count frames from first on as interleaved floats of outChannels, which
+    // may differ from the file's only by mono to stereo and stereo to mono
+    int read(qint64 first, int count, float *out, int outChannels);
+
+    static sampleType typeFromName(const QString &name);
+    // the channel mix audioconvert does in front of the sink, 1 or 2 channels each
+    static void mixChannels(const float *in, int inChannels, int frames, float *out, int outChannels);
+
+private:
+    bool parseWav(const uchar *data, qint64 size);
+    bool parseAiff(const uchar *data, qint64 size);
+    bool setFormat(int rate, int channels, int bits, bool isFloat, bool isSigned, bool bigEndian);
+
+    QFile m_file;
+    const uchar *m_data;
+    const uchar *m_samples;
+    qint64 m_frames;
+    int m_rate;
+    int m_channels;
+    sampleType m_type;
+    bool m_bigEndian;
+    int m_frameBytes;
+    int m_rawRate;
+    int m_rawChannels;
+    sampleType m_rawType;
+    bool m_rawBigEndian;
+    QVector<float> m_scratch;
+};
+
+#endif // PCMFILE_H
@@ -0,0 +1,270 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resultcache.h"
+
+#include <atomic>
+#include <string.h>
+
+#define CACHE_MAGIC "BTACACHE"
+#define CACHE_VERSION 1
+// slots tried after the home slot of a key, a full run evicts the home slot
+#define MAX_PROBE 16
+// bytes of the head and the tail of a file which make up its content hash
+#define CONTENT_BLOCK 65536
+
+struct CacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 slots;
+    quint32 recordSize;
+    quint32 reserved;
+};
+
+struct ResultCache::Record
+{
+    QBasicAtomicInt sequence;
+    quint32 reserved;
+    quint64 key;
+    double gainDB;
+    float confidence;
+    qint32 bpm;
+    qint32 startMs;
+    qint32 endMs;
+    qint32 lengthMs;
+    qint32 reserved2;
+};
+
+static quint64 fnv1a(const char *data, int size, quint64 hash = 14695981039346656037ULL)
+{
+    for (int i = 0; i < size; i++) {
+        hash ^= (uchar)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static quint64 fnv1a(const QByteArray &data, quint64 hash = 14695981039346656037ULL)
+{
+    return fnv1a(data.constData(), data.size(), hash);
+}
+
+ResultCache::ResultCache(const QString &fileName, int slots) :
+    m_lock(0), m_map(0), m_records(0), m_slots(qMax(slots, MAX_PROBE)), m_contentHash(false)
+{
+    m_file.setFileName(fileName.isEmpty() ? defaultFileName() : fileName);
+    QDir().mkpath(QFileInfo(m_file).absolutePath());
+
+    m_lock = new QLockFile(m_file.fileName() + ".lock");
+    if (!m_lock->tryLock(5000)) {
+        qWarning() << Q_FUNC_INFO << ": cache" << m_file.fileName() << "is locked";
+        return;
+    }
+
+    qint64 size = sizeof(CacheHeader) + (qint64)m_slots * sizeof(Record);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << Q_FUNC_INFO << ": can not open cache" << m_file.fileName();
+        m_lock->unlock();
+        return;
+    }
+
+    // a new or foreign file starts over, a cache of another size is taken as it is
+    CacheHeader header;
+    bool valid = m_file.size() >= (qint64)sizeof(header)
+            && m_file.read((char *)&header, sizeof(header)) == sizeof(header)
+            && memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+            && header.version == CACHE_VERSION
+            && header.recordSize == sizeof(Record)
+            && m_file.size() == sizeof(CacheHeader) + (qint64)header.slots * sizeof(Record);
+    if (valid) {
+        m_slots = header.slots;
+        size = m_file.size();
+    } else {
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.version = CACHE_VERSION;
+        header.slots = m_slots;
+        header.recordSize = sizeof(Record);
+        header.reserved = 0;
+
+        // other processes may still have the old file mapped, shrinking it would fault
+        // their reads, so a new file is renamed over it while the lock is held
+        m_file.close();
+        QSaveFile fresh(m_file.fileName());
+        QByteArray records(size - sizeof(header), 0);
+        if (!fresh.open(QIODevice::WriteOnly)
+                || fresh.write((const char *)&header, sizeof(header)) != sizeof(header)
+                || fresh.write(records) != records.size()
+                || !fresh.commit()
+                || !m_file.open(QIODevice::ReadWrite)) {
+            qWarning() << Q_FUNC_INFO << ": can not create cache" << m_file.fileName();
+            m_lock->unlock();
+            return;
+        }
+    }
+
+    m_map = m_file.map(0, size);
+    if (m_map)
+        m_records = (Record *)(m_map + sizeof(CacheHeader));
+    else
+        qWarning() << Q_FUNC_INFO << ": can not map cache" << m_file.fileName();
+    m_lock->unlock();
+}
+
+ResultCache::~ResultCache()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    delete m_lock;
+}
+
+QString ResultCache::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results.cache";
+}
+
+quint64 ResultCache::identityKey(const QString &file, const QByteArray &parameters)
+{
+    QFileInfo info(file);
+    if (!info.exists())
+        return 0;
+
+    QByteArray identity = info.canonicalFilePath().toUtf8();
+    identity += '\0' + QByteArray::number(info.size());
+    identity += '\0' + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    identity += '\0' + parameters;
+    return fnv1a(identity) | 1; // 0 marks a free slot
+}
+
+quint64 ResultCache::contentKey(const QString &file, const QByteArray &parameters)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly))
+        return 0;
+
+    quint64 hash = fnv1a(QByteArray("content\0", 8) + QByteArray::number(f.size()) + '\0' + parameters);
+    hash = fnv1a(f.read(CONTENT_BLOCK), hash);
+    if (f.size() > 2 * CONTENT_BLOCK) {
+        f.seek(f.size() - CONTENT_BLOCK);
+        hash = fnv1a(f.read(CONTENT_BLOCK), hash);
+    }
+    return hash | 1;
+}
+
+bool ResultCache::read(quint64 key, Result *result)
+{
+    int home = key % m_slots;
+    for (int i = 0; i <= MAX_PROBE; i++) {
+        Record *record = &m_records[(home + i) % m_slots];
+        Record copy;
+        int sequence;
+        int retries = 0;
+        do {
+            // a writer in another process holds the record, try again
+            sequence = record->sequence.loadAcquire();
+            if (sequence & 1) {
+                if (++retries > 1000)
+                    return false;
+                QThread::yieldCurrentThread();
+                continue;
+            }
+            memcpy(&copy, record, sizeof(copy));
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || record->sequence.load() != sequence);
+
+        if (copy.key == 0)
+            return false;
+        if (copy.key == key) {
+            result->bpm = copy.bpm;
+            result->confidence = copy.confidence;
+            result->gainDB = copy.gainDB;
+            result->startMs = copy.startMs;
+            result->endMs = copy.endMs;
+            result->lengthMs = copy.lengthMs;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ResultCache::write(quint64 key, const Result &result)
+{
+    int home = key % m_slots;
+    Record *record = &m_records[home];
+    for (int i = 0; i <= MAX_PROBE; i++) {
+        Record *slot = &m_records[(home + i) % m_slots];
+        if (slot->key == key || slot->key == 0) {
+            record = slot;
+            break;
+        }
+    }
+
+    int sequence = record->sequence.load();
+    record->sequence.storeRelease(sequence + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    record->key = key;
+    record->gainDB = result.gainDB;
+    record->confidence = result.confidence;
+    record->bpm = result.bpm;
+    record->startMs = result.startMs;
+    record->endMs = result.endMs;
+    record->lengthMs = result.lengthMs;
+    record->sequence.storeRelease(sequence + 2);
+    return true;
+}
+
+bool ResultCache::lookup(const QString &file, const QByteArray &parameters, Result *result)
+{
+    if (!isOpen())
+        return false;
+
+    quint64 key = identityKey(file, parameters);
+    if (key && read(key, result))
+        return true;
+
+    if (!m_contentHash)
+        return false;
+
+    // known content under another name or time, remember the new identity as well
+    quint64 content = contentKey(file, parameters);
+    if (!content || !read(content, result))
+        return false;
+    QMutexLocker locker(&m_mutex);
+    if (key && m_lock->tryLock(100)) {
+        write(key, *result);
+        m_lock->unlock();
+    }
+    return true;
+}
+
+bool ResultCache::store(const QString &file, const QByteArray &parameters, const Result &result)
+{
+    if (!isOpen())
+        return false;
+
+    quint64 key = identityKey(file, parameters);
+    quint64 content = m_contentHash ? contentKey(file, parameters) : 0;
+    QMutexLocker locker(&m_mutex);
+    if (!key || !m_lock->tryLock(1000))
+        return false;
+
+    write(key, result);
+    if (content)
+        write(content, result);
+    m_lock->unlock();
+    return true;
+}
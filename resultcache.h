@@ -0,0 +1,71 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QtCore>
+
+// Analysis results on disk, keyed by path, size and modification time of a
+// file plus the parameters of the analysis. The cache file is a fixed hash
+// table which is memory mapped by every process using it. Lookups do not
+// lock, each record carries a sequence number which is odd while it is
+// written; writers serialize on a mutex and a lock file next to the cache.
+class ResultCache
+{
+public:
+    struct Result {
+        int bpm;
+        float confidence;
+        double gainDB;
+        int startMs;
+        int endMs;
+        int lengthMs;
+    };
+
+    explicit ResultCache(const QString &fileName = QString(), int slots = 65536);
+    ~ResultCache();
+
+    bool isOpen() const {return m_records != 0;}
+    QString fileName() const {return m_file.fileName();}
+    static QString defaultFileName();
+
+    // hash the head and tail of a file when its identity is unknown, finds moved or touched files
+    void setContentHash(bool enabled) {m_contentHash = enabled;}
+
+    bool lookup(const QString &file, const QByteArray &parameters, Result *result);
+    bool store(const QString &file, const QByteArray &parameters, const Result &result);
+
+private:
+    struct Record;
+
+    QFile m_file;
+    QLockFile *m_lock;
+    QMutex m_mutex;
+    uchar *m_map;
+    Record *m_records;
+    int m_slots;
+    bool m_contentHash;
+
+    bool read(quint64 key, Result *result);
+    bool write(quint64 key, const Result &result);
+    static quint64 identityKey(const QString &file, const QByteArray &parameters);
+    static quint64 contentKey(const QString &file, const QByteArray &parameters);
+
+    Q_DISABLE_COPY(ResultCache)
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "samplering.h"
+
+#include <string.h>
+
+// sleep while waiting, a wake up lost between the flag and the wait only costs one period
+#define WAIT_MS 5
+
+SampleRing::SampleRing() :
+    m_data(0), m_capacity(0), m_channels(0), m_parked(false)
+{
+    clear();
+}
+
+SampleRing::~SampleRing()
+{
+    delete[] m_data;
+}
+
+void SampleRing::reset(int channels, int frames)
+{
+    // one frame stays free to tell a full ring from an empty one
+    int capacity = channels * (frames + 1);
+    if ( capacity != m_capacity ) {
+        delete[] m_data;
+        m_data = new float[capacity];
+        m_capacity = capacity;
+    }
+    m_channels = channels;
+    clear();
+}
+
+void SampleRing::clear()
+{
+    m_head.storeRelease(0);
+    m_tail.storeRelease(0);
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_fillSum = 0;
+}
+
+int SampleRing::used(int head, int tail) const
+{
+    return head >= tail ? head - tail : m_capacity - tail + head;
+}
+
+int SampleRing::fill() const
+{
+    if ( m_channels == 0 )
+        return 0;
+    return used(m_head.loadAcquire(), m_tail.loadAcquire()) / m_channels;
+}
+
+SampleRing::Stats SampleRing::stats() const
+{
+    Stats stats = m_stats;
+    stats.meanFill = m_stats.writes > 0 && capacity() > 0
+            ? m_fillSum / m_stats.writes / capacity() : 0;
+    return stats;
+}
+
+bool SampleRing::write(const float *data, int frames, const QAtomicInt &abort)
+{
+    if ( m_capacity == 0 )
+        return false;
+
+    int head = m_head.load();
+    int fillFrames = used(head, m_tail.loadAcquire()) / m_channels;
+    m_fillSum += fillFrames;
+    m_stats.writes++;
+
+    int remaining = frames * m_channels;
+    bool stalled = false;
+    while ( remaining > 0 ) {
+        int tail = m_tail.loadAcquire();
+        int space = m_capacity - m_channels - used(head, tail);
+        if ( space <= 0 ) {
+            if ( abort.loadAcquire() )
+                return false;
+            if ( !stalled ) {
+                stalled = true;
+                m_stats.stalls++;
+            }
+            m_mutex.lock();
+            m_writerWaiting.fetchAndStoreOrdered(1);
+            if ( m_tail.loadAcquire() == tail )
+                m_writable.wait(&m_mutex, WAIT_MS);
+            m_writerWaiting.storeRelease(0);
+            m_mutex.unlock();
+            continue;
+        }
+
+        int count = qMin(qMin(space, remaining), m_capacity - head);
+        memcpy(m_data + head, data, count * sizeof(float));
+        data += count;
+        remaining -= count;
+        head = (head + count) % m_capacity;
+        m_head.fetchAndStoreOrdered(head);
+
+        fillFrames = used(head, tail) / m_channels;
+        if ( fillFrames > m_stats.peakFill )
+            m_stats.peakFill = fillFrames;
+
+        // only a sleeping reader needs the mutex
+        if ( m_readerWaiting.loadAcquire() ) {
+            m_mutex.lock();
+            m_readable.wakeOne();
+            m_mutex.unlock();
+        }
+    }
+    m_stats.frames += frames;
+    return true;
+}
+
+const float *SampleRing::peek(int *frames) const
+{
+    int head = m_head.loadAcquire();
+    int tail = m_tail.load();
+    int count = head >= tail ? head - tail : m_capacity - tail;
+    *frames = m_channels ? count / m_channels : 0;
+    return m_data + tail;
+}
+
+void SampleRing::consume(int frames)
+{
+    int tail = (m_tail.load() + frames * m_channels) % m_capacity;
+    m_tail.fetchAndStoreOrdered(tail);
+
+    // only a sleeping writer needs the mutex
+    if ( m_writerWaiting.loadAcquire() ) {
+        m_mutex.lock();
+        m_writable.wakeAll();
+        m_mutex.unlock();
+    }
+}
+
+bool SampleRing::waitForData(int timeoutMs)
+{
+    m_mutex.lock();
+    // parked the reader touches nothing of the ring until it is released
+    if ( m_park.loadAcquire() ) {
+        m_parked = true;
+        m_writable.wakeAll();
+        while ( m_park.loadAcquire() )
+            m_readable.wait(&m_mutex);
+        m_parked = false;
+        m_mutex.unlock();
+        return false;
+    }
+
+    m_readerWaiting.fetchAndStoreOrdered(1);
+    bool empty = m_head.loadAcquire() == m_tail.loadAcquire();
+    if ( empty ) {
+        m_readable.wait(&m_mutex, timeoutMs);
+        empty = m_head.loadAcquire() == m_tail.loadAcquire();
+    }
+    m_readerWaiting.storeRelease(0);
+    m_mutex.unlock();
+    return !empty;
+}
+
+void SampleRing::drain()
+{
+    m_mutex.lock();
+    m_writerWaiting.fetchAndStoreOrdered(1);
+    while ( m_head.loadAcquire() != m_tail.loadAcquire() )
+        m_writable.wait(&m_mutex, WAIT_MS);
+    m_writerWaiting.storeRelease(0);
+    m_mutex.unlock();
+}
+
+void SampleRing::park()
+{
+    // the reader parks once it found the ring empty, so everything is read by then
+    m_mutex.lock();
+    m_park.storeRelease(1);
+    m_readable.wakeOne();
+    while ( !m_parked )
+        m_writable.wait(&m_mutex, WAIT_MS);
+    m_mutex.unlock();
+}
+
+void SampleRing::unpark()
+{
+    m_mutex.lock();
+    m_park.storeRelease(0);
+    m_readable.wakeOne();
+    m_mutex.unlock();
+}
@@ -0,0 +1,89 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Single producer, single consumer ring of interleaved samples.
+// The indexes are atomics, so writing and reading never take a lock;
+// the mutex is only taken by a side which sleeps while the ring is full
+// or empty, and by the other one only to wake it.
+// Both indexes always stay on frame boundaries, so a contiguous part
+// of the ring holds whole frames.
+class SampleRing
+{
+public:
+    struct Stats {
+        qint64 frames;      // frames written
+        qint64 writes;      // buffers written
+        qint64 stalls;      // writes which waited for free space
+        int peakFill;       // most frames in the ring at once
+        double meanFill;    // mean fill before each write, 0..1
+    };
+
+    SampleRing();
+    ~SampleRing();
+
+    // not thread safe, only while both sides are idle or the consumer is parked
+    void reset(int channels, int frames);
+    // producer: waits until the consumer sleeps without touching the ring, until unpark()
+    void park();
+    void unpark();
+    void clear();
+
+    int channels() const {return m_channels;}
+    int capacity() const {return m_capacity / (m_channels ? m_channels : 1);}
+    int fill() const;
+    Stats stats() const;
+
+    // producer: blocks while the ring is full unless abort becomes non zero
+    bool write(const float *data, int frames, const QAtomicInt &abort);
+    // consumer: contiguous readable frames, consume() them once done
+    const float *peek(int *frames) const;
+    void consume(int frames);
+    bool waitForData(int timeoutMs);
+    // blocks until the consumer read everything
+    void drain();
+
+private:
+    float *m_data;
+    int m_capacity;
+    int m_channels;
+    QAtomicInt m_head;
+    QAtomicInt m_tail;
+    QAtomicInt m_readerWaiting;
+    QAtomicInt m_writerWaiting;
+    QAtomicInt m_park;
+    bool m_parked;
+
+    QMutex m_mutex;
+    QWaitCondition m_readable;
+    QWaitCondition m_writable;
+
+    Stats m_stats;
+    double m_fillSum;
+
+    int used(int head, int tail) const;
+
+    SampleRing(const SampleRing&);
+    SampleRing& operator=(const SampleRing&);
+};
+
+#endif // SAMPLERING_H
@@ -0,0 +1,310 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "spectralflux.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define SPECTRALFLUX_X86
+ #include <immintrin.h>
+#endif
+
+// band masks: one row of 0/1 weights per band, so no bin needs a branch
+typedef void (*FluxKernel)(const float *complex, float *last, const float *masks, int stride, int bins, float *flux);
+typedef void (*DownmixKernel)(const float *data, int frames, float *mono);
+
+static void flux_scalar(const float *complex, float *last, const float *masks, int stride, int bins, float *flux)
+{
+    float sum[SpectralFlux::BAND_COUNT] = {0, 0, 0, 0};
+
+    for (int i = 0; i < bins; i++) {
+        float r = complex[2 * i];
+        float im = complex[2 * i + 1];
+        float val = sqrtf(r * r + im * im);
+        float value = val - last[i];
+        last[i] = val;
+        float rect = value < 0 ? 0 : value;
+        sum[SpectralFlux::ALL] += rect;
+        sum[SpectralFlux::BD] += rect * masks[SpectralFlux::BD * stride + i];
+        sum[SpectralFlux::SD] += rect * masks[SpectralFlux::SD * stride + i];
+        sum[SpectralFlux::HH] += rect * masks[SpectralFlux::HH * stride + i];
+    }
+    for (int b = 0; b < SpectralFlux::BAND_COUNT; b++)
+        flux[b] = sum[b];
+}
+
+static void downmix_stereo_scalar(const float *data, int frames, float *mono)
+{
+    for (int i = 0; i < frames; i++)
+        mono[i] = (data[2 * i] + data[2 * i + 1]) / 2;
+}
+
+#ifdef SPECTRALFLUX_X86
+
+__attribute__((target("sse2")))
+static inline float hsum_sse2(__m128 v)
+{
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("sse2")))
+static void flux_sse2(const float *complex, float *last, const float *masks, int stride, int bins, float *flux)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 accAll = zero, accBD = zero, accSD = zero, accHH = zero;
+    const float *maskBD = masks + SpectralFlux::BD * stride;
+    const float *maskSD = masks + SpectralFlux::SD * stride;
+    const float *maskHH = masks + SpectralFlux::HH * stride;
+
+    int i = 0;
+    for (; i + 4 <= bins; i += 4) {
+        __m128 a = _mm_loadu_ps(complex + 2 * i);
+        __m128 b = _mm_loadu_ps(complex + 2 * i + 4);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 val = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+        __m128 rect = _mm_max_ps(_mm_sub_ps(val, _mm_loadu_ps(last + i)), zero);
+        _mm_storeu_ps(last + i, val);
+        accAll = _mm_add_ps(accAll, rect);
+        accBD = _mm_add_ps(accBD, _mm_mul_ps(rect, _mm_loadu_ps(maskBD + i)));
+        accSD = _mm_add_ps(accSD, _mm_mul_ps(rect, _mm_loadu_ps(maskSD + i)));
+        accHH = _mm_add_ps(accHH, _mm_mul_ps(rect, _mm_loadu_ps(maskHH + i)));
+    }
+
+    float tail[SpectralFlux::BAND_COUNT] = {0, 0, 0, 0};
+    if (i < bins) {
+        float tailMasks[SpectralFlux::BAND_COUNT * 4];
+        int rest = bins - i;
+        for (int b = 0; b < SpectralFlux::BAND_COUNT; b++)
+            memcpy(tailMasks + b * 4, masks + b * stride + i, rest * sizeof(float));
+        flux_scalar(complex + 2 * i, last + i, tailMasks, 4, rest, tail);
+    }
+
+    flux[SpectralFlux::ALL] = hsum_sse2(accAll) + tail[SpectralFlux::ALL];
+    flux[SpectralFlux::BD] = hsum_sse2(accBD) + tail[SpectralFlux::BD];
+    flux[SpectralFlux::SD] = hsum_sse2(accSD) + tail[SpectralFlux::SD];
+    flux[SpectralFlux::HH] = hsum_sse2(accHH) + tail[SpectralFlux::HH];
+}
+
+__attribute__((target("sse2")))
+static void downmix_stereo_sse2(const float *data, int frames, float *mono)
+{
+    __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(data + 2 * i);
+        __m128 b = _mm_loadu_ps(data + 2 * i + 4);
+        __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(mono + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+    downmix_stereo_scalar(data + 2 * i, frames - i, mono + i);
+}
+
+__attribute__((target("avx2")))
+static inline float hsum_avx(__m256 v)
+{
+    __m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuf = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(2, 3, 0, 1));
+    sums = _mm_add_ps(sums, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+// shuffle_ps works per 128 bit lane, this puts the 64 bit pairs back in order
+__attribute__((target("avx2")))
+static inline __m256 lane_order_avx2(__m256 v)
+{
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2")))
+static void flux_avx2(const float *complex, float *last, const float *masks, int stride, int bins, float *flux)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 accAll = zero, accBD = zero, accSD = zero, accHH = zero;
+    const float *maskBD = masks + SpectralFlux::BD * stride;
+    const float *maskSD = masks + SpectralFlux::SD * stride;
+    const float *maskHH = masks + SpectralFlux::HH * stride;
+
+    int i = 0;
+    for (; i + 8 <= bins; i += 8) {
+        __m256 a = _mm256_loadu_ps(complex + 2 * i);
+        __m256 b = _mm256_loadu_ps(complex + 2 * i + 8);
+        __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 val = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im)));
+        val = lane_order_avx2(val);
+        __m256 rect = _mm256_max_ps(_mm256_sub_ps(val, _mm256_loadu_ps(last + i)), zero);
+        _mm256_storeu_ps(last + i, val);
+        accAll = _mm256_add_ps(accAll, rect);
+        accBD = _mm256_add_ps(accBD, _mm256_mul_ps(rect, _mm256_loadu_ps(maskBD + i)));
+        accSD = _mm256_add_ps(accSD, _mm256_mul_ps(rect, _mm256_loadu_ps(maskSD + i)));
+        accHH = _mm256_add_ps(accHH, _mm256_mul_ps(rect, _mm256_loadu_ps(maskHH + i)));
+    }
+
+    float tail[SpectralFlux::BAND_COUNT] = {0, 0, 0, 0};
+    if (i < bins) {
+        float tailMasks[SpectralFlux::BAND_COUNT * 8];
+        int rest = bins - i;
+        for (int b = 0; b < SpectralFlux::BAND_COUNT; b++)
+            memcpy(tailMasks + b * 8, masks + b * stride + i, rest * sizeof(float));
+        flux_scalar(complex + 2 * i, last + i, tailMasks, 8, rest, tail);
+    }
+
+    flux[SpectralFlux::ALL] = hsum_avx(accAll) + tail[SpectralFlux::ALL];
+    flux[SpectralFlux::BD] = hsum_avx(accBD) + tail[SpectralFlux::BD];
+    flux[SpectralFlux::SD] = hsum_avx(accSD) + tail[SpectralFlux::SD];
+    flux[SpectralFlux::HH] = hsum_avx(accHH) + tail[SpectralFlux::HH];
+}
+
+__attribute__((target("avx2")))
+static void downmix_stereo_avx2(const float *data, int frames, float *mono)
+{
+    __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a = _mm256_loadu_ps(data + 2 * i);
+        __m256 b = _mm256_loadu_ps(data + 2 * i + 8);
+        __m256 left = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 right = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 avg = _mm256_mul_ps(_mm256_add_ps(left, right), half);
+        _mm256_storeu_ps(mono + i, lane_order_avx2(avg));
+    }
+    downmix_stereo_sse2(data + 2 * i, frames - i, mono + i);
+}
+
+#endif // SPECTRALFLUX_X86
+
+struct Kernels
+{
+    FluxKernel flux;
+    DownmixKernel downmixStereo;
+    const char *name;
+};
+
+static Kernels selectKernels()
+{
+    Kernels kernels = { flux_scalar, downmix_stereo_scalar, "scalar" };
+#ifdef SPECTRALFLUX_X86
+    __builtin_cpu_init();
+    if (getenv("BEATANALYSIS_NO_SIMD"))
+        return kernels;
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.flux = flux_avx2;
+        kernels.downmixStereo = downmix_stereo_avx2;
+        kernels.name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        kernels.flux = flux_sse2;
+        kernels.downmixStereo = downmix_stereo_sse2;
+        kernels.name = "sse2";
+    }
+#endif
+    return kernels;
+}
+
+static Kernels& kernels()
+{
+    static Kernels selected = selectKernels();
+    return selected;
+}
+
+SpectralFlux::SpectralFlux(int bins) :
+    m_bins(bins)
+{
+    m_padded = (bins + 7) & ~7;
+    m_masks = new float[BAND_COUNT * m_padded];
+    memset(m_masks, 0, BAND_COUNT * m_padded * sizeof(float));
+    setBand(ALL, 0, bins - 1);
+}
+
+SpectralFlux::~SpectralFlux()
+{
+    delete[] m_masks;
+}
+
+void SpectralFlux::setBand(bandType band, int first, int last)
+{
+    float *mask = m_masks + band * m_padded;
+    for (int i = 0; i < m_bins; i++)
+        mask[i] = (i >= first && i <= last) ? 1.0f : 0.0f;
+}
+
+void SpectralFlux::process(const float *complex, float *last, float *flux)
+{
+    kernels().flux(complex, last, m_masks, m_padded, m_bins, flux);
+}
+
+void SpectralFlux::downmix(const float *data, int channels, int frames, float *mono)
+{
+    if (channels == 2) {
+        kernels().downmixStereo(data, frames, mono);
+        return;
+    }
+    if (channels == 1) {
+        memcpy(mono, data, frames * sizeof(float));
+        return;
+    }
+
+    for (int i = 0; i < frames; i++) {
+        float avg = 0.0f;
+        for (int j = 0; j < channels; j++)
+            avg += data[i * channels + j];
+        mono[i] = avg / channels;
+    }
+}
+
+const char* SpectralFlux::kernelName()
+{
+    return kernels().name;
+}
+
+bool SpectralFlux::setKernels(const char *name)
+{
+    Kernels forced = { flux_scalar, downmix_stereo_scalar, "scalar" };
+    if (strcmp(name, "scalar") == 0) {
+        kernels() = forced;
+        return true;
+    }
+#ifdef SPECTRALFLUX_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        forced.flux = flux_avx2;
+        forced.downmixStereo = downmix_stereo_avx2;
+        forced.name = "avx2";
+        kernels() = forced;
+        return true;
+    }
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        forced.flux = flux_sse2;
+        forced.downmixStereo = downmix_stereo_sse2;
+        forced.name = "sse2";
+        kernels() = forced;
+        return true;
+    }
+#endif
+    return false;
+}
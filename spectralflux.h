@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SPECTRALFLUX_H
+#define SPECTRALFLUX_H
+
+// Per frame kernels of the onset detection: downmix of the interleaved
+// samples and the half-wave rectified spectral flux, summed for all bins
+// and for the drum bands. Picks SSE2 or AVX2 at runtime where available.
+class SpectralFlux
+{
+public:
+    enum bandType { ALL, BD, SD, HH, BAND_COUNT };
+
+    SpectralFlux(int bins);
+    ~SpectralFlux();
+
+    // bins first..last (inclusive) belong to band
+    void setBand(bandType band, int first, int last);
+    int bins() {return m_bins;}
+
+    // complex holds bins() pairs of real and imaginary part, last the magnitudes
+    // of the previous frame which get replaced, flux gets one sum per band
+    void process(const float *complex, float *last, float *flux);
+
+    static void downmix(const float *data, int channels, int frames, float *mono);
+
+    static const char* kernelName();
+    // forces the kernels of name (scalar, sse2 or avx2) before any analysis runs,
+    // false if this cpu lacks them; for tests and benchmarks
+    static bool setKernels(const char *name);
+
+private:
+    int m_bins;
+    int m_padded;
+    float *m_masks;
+};
+
+#endif // SPECTRALFLUX_H
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Unit tests of the analysis core, run them with
+# make check
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+TARGET = tst_spectralflux
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+SOURCES += tst_spectralflux.cpp
+
+include(../core.pri)
@@ -0,0 +1,149 @@
+/*
+    Copyright (C) 2014 Mario Stephan <mstephan@shared-files.de>
+
+    This library is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published
+    by the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QVector>
+
+#include <math.h>
+
+#include "spectralflux.h"
+
+// Every kernel of this cpu against the scalar one, on random spectra and
+// samples whose sizes leave a tail after the last full vector.
+class TestSpectralFlux : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanupTestCase();
+    void flux_data();
+    void flux();
+    void downmix_data();
+    void downmix();
+
+private:
+    void addKernels(const char *column);
+};
+
+static float randomFloat(float range)
+{
+    return range * ( 2.0f * qrand() / RAND_MAX - 1.0f );
+}
+
+void TestSpectralFlux::init()
+{
+    qsrand(4711);
+}
+
+void TestSpectralFlux::cleanupTestCase()
+{
+    SpectralFlux::setKernels("scalar");
+}
+
+void TestSpectralFlux::addKernels(const char *column)
+{
+    QTest::addColumn<QString>("kernel");
+    QTest::addColumn<int>(column);
+
+    const char *kernels[] = { "sse2", "avx2" };
+    const int sizes[] = { 1, 3, 7, 9, 13, 17, 31, 33, 257, 513, 1025 };
+    for (int k = 0; k < 2; k++)
+        for (int s = 0; s < int(sizeof(sizes) / sizeof(sizes[0])); s++)
+            QTest::newRow(qPrintable(QString("%1/%2").arg(kernels[k]).arg(sizes[s])))
+                    << QString(kernels[k]) << sizes[s];
+}
+
+void TestSpectralFlux::flux_data()
+{
+    addKernels("bins");
+}
+
+void TestSpectralFlux::flux()
+{
+    QFETCH(QString, kernel);
+    QFETCH(int, bins);
+
+    SpectralFlux flux(bins);
+    flux.setBand(SpectralFlux::BD, 0, bins / 8);
+    flux.setBand(SpectralFlux::SD, bins / 8, bins / 3);
+    flux.setBand(SpectralFlux::HH, bins / 2, bins - 1);
+
+    QVector<float> complex(2 * bins);
+    QVector<float> last(bins);
+    for (int i = 0; i < last.size(); i++)
+        last[i] = qAbs(randomFloat(8.0f));
+
+    // a few frames in a row, each one depends on the magnitudes of the last
+    QVector<float> scalarLast = last;
+    for (int frame = 0; frame < 4; frame++) {
+        float magnitudes = 0;
+        for (int i = 0; i < complex.size(); i++) {
+            complex[i] = randomFloat(8.0f);
+            magnitudes += qAbs(complex[i]);
+        }
+
+        float expected[SpectralFlux::BAND_COUNT];
+        QVERIFY(SpectralFlux::setKernels("scalar"));
+        flux.process(complex.constData(), scalarLast.data(), expected);
+
+        if (!SpectralFlux::setKernels(qPrintable(kernel)))
+            QSKIP("not supported by this cpu");
+        float actual[SpectralFlux::BAND_COUNT];
+        flux.process(complex.constData(), last.data(), actual);
+
+        // the vector sums add up in another order
+        float tolerance = 1e-5f * magnitudes + 1e-6f;
+        for (int b = 0; b < SpectralFlux::BAND_COUNT; b++)
+            QVERIFY2(qAbs(actual[b] - expected[b]) <= tolerance,
+                     qPrintable(QString("band %1: %2 instead of %3").arg(b).arg(actual[b]).arg(expected[b])));
+        for (int i = 0; i < bins; i++)
+            QVERIFY(qAbs(last[i] - scalarLast[i]) <= 1e-5f * scalarLast[i] + 1e-6f);
+    }
+}
+
+void TestSpectralFlux::downmix_data()
+{
+    addKernels("frames");
+}
+
+void TestSpectralFlux::downmix()
+{
+    QFETCH(QString, kernel);
+    QFETCH(int, frames);
+
+    QVector<float> stereo(2 * frames);
+    for (int i = 0; i < stereo.size(); i++)
+        stereo[i] = randomFloat(1.0f);
+
+    QVector<float> expected(frames);
+    QVERIFY(SpectralFlux::setKernels("scalar"));
+    SpectralFlux::downmix(stereo.constData(), 2, frames, expected.data());
+
+    if (!SpectralFlux::setKernels(qPrintable(kernel)))
+        QSKIP("not supported by this cpu");
+    QVector<float> mono(frames);
+    SpectralFlux::downmix(stereo.constData(), 2, frames, mono.data());
+
+    for (int i = 0; i < frames; i++)
+        QVERIFY2(qAbs(mono[i] - expected[i]) <= 1e-6f,
+                 qPrintable(QString("frame %1: %2 instead of %3").arg(i).arg(mono[i]).arg(expected[i])));
+}
+
+QTEST_APPLESS_MAIN(TestSpectralFlux)
+
+#include "tst_spectralflux.moc"